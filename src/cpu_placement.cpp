@@ -0,0 +1,458 @@
+#include "cpu_placement.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+// the SIMD kernels are compiled for their own instruction set whatever the target, and picked at run time
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define CPU_PLACEMENT_X86 1
+#include <immintrin.h>
+#else
+#define CPU_PLACEMENT_X86 0
+#endif
+
+namespace {
+
+/// bayerThreshold() of placement.comp for a @p size x @p size matrix.
+float bayerThreshold(glm::uvec2 id, std::uint32_t size) {
+    std::uint32_t value = 0;
+    for (std::uint32_t bit = 0; (1u << bit) < size; bit++) {
+        const glm::uvec2 b = (id >> bit) & 1u;
+        value = value * 4 + 2 * (b.x ^ b.y) + b.y;
+    }
+    return static_cast<float>(value) / static_cast<float>(size * size);
+}
+
+float unorm8(std::uint32_t texel, int channel) {
+    return static_cast<float>((texel >> (8 * channel)) & 0xffu) / 255.0f;
+}
+
+std::uint32_t pcg(std::uint32_t v) {
+    const std::uint32_t state = v * 747796405u + 2891336453u;
+    const std::uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+float unitFloat(std::uint32_t h) {
+    return static_cast<float>(h >> 8) / 16777216.0f;
+}
+
+/// cellHash() of placement.comp.
+std::uint32_t cellHash(glm::uvec2 cell, std::uint32_t seed, std::uint32_t stream) {
+    return pcg(cell.x + pcg(cell.y + pcg(seed + stream)));
+}
+
+/// gc_attribute_stream in placement.comp.
+constexpr std::uint32_t attribute_stream = 3 + PlacementParameters::max_species;
+
+/// Texel coordinates of the two texels blended along one axis, and the weight of the second one.
+struct LinearTaps {
+    int i0;
+    int i1;
+    float weight;
+};
+
+LinearTaps linearTaps(float tex_coord, int size) {
+    const float u = tex_coord * static_cast<float>(size) - 0.5f;
+    const float u0 = std::floor(u);
+    const int i = static_cast<int>(std::clamp(u0, -1.0f, static_cast<float>(size)));
+    return {std::clamp(i, 0, size - 1), std::clamp(i + 1, 0, size - 1), u - u0};
+}
+
+#if CPU_PLACEMENT_X86
+
+using Channels = float[4][CpuPlacement::block_size];
+
+/// Texel indices of the two texels blended along one axis and the weight of the second one, like linearTaps().
+__attribute__((target("avx2")))
+__m256 linearTapsAvx2(__m256 tex_coord, int size, __m256i &i0, __m256i &i1) {
+    const __m256 u = _mm256_sub_ps(_mm256_mul_ps(tex_coord, _mm256_set1_ps(static_cast<float>(size))),
+                                   _mm256_set1_ps(0.5f));
+    const __m256 u0 = _mm256_floor_ps(u);
+    const __m256 u0_clamped = _mm256_min_ps(_mm256_max_ps(u0, _mm256_set1_ps(-1.0f)),
+                                            _mm256_set1_ps(static_cast<float>(size)));
+    const __m256i max_index = _mm256_set1_epi32(size - 1);
+    const __m256i i = _mm256_cvttps_epi32(u0_clamped);
+    i0 = _mm256_max_epi32(_mm256_min_epi32(i, max_index), _mm256_setzero_si256());
+    i1 = _mm256_max_epi32(_mm256_min_epi32(_mm256_add_epi32(i, _mm256_set1_epi32(1)), max_index),
+                          _mm256_setzero_si256());
+    return _mm256_sub_ps(u, u0);
+}
+
+/// Channel @p c of 8 RGBA8 texels, as unorm floats.
+__attribute__((target("avx2")))
+__m256 channelAvx2(__m256i texels, int c) {
+    const __m256i value = _mm256_and_si256(_mm256_srl_epi32(texels, _mm_cvtsi32_si128(8 * c)), _mm256_set1_epi32(0xff));
+    return _mm256_div_ps(_mm256_cvtepi32_ps(value), _mm256_set1_ps(255.0f));
+}
+
+/// CpuPlacement::sample() of the 8 lanes of a row.
+__attribute__((target("avx2")))
+void sampleLanesAvx2(const std::uint32_t *texels, glm::ivec2 size, const float *tex_x, const float *tex_y,
+                     Channels &channels) {
+    __m256i x0, x1, y0, y1;
+    const __m256 weight_x = linearTapsAvx2(_mm256_load_ps(tex_x), size.x, x0, x1);
+    const __m256 weight_y = linearTapsAvx2(_mm256_load_ps(tex_y), size.y, y0, y1);
+
+    const __m256i width = _mm256_set1_epi32(size.x);
+    const __m256i row0 = _mm256_mullo_epi32(y0, width);
+    const __m256i row1 = _mm256_mullo_epi32(y1, width);
+    const auto *base = reinterpret_cast<const int *>(texels);
+
+    // a single gather fetches the four channels of a texel
+    const __m256i t00 = _mm256_i32gather_epi32(base, _mm256_add_epi32(row0, x0), 4);
+    const __m256i t10 = _mm256_i32gather_epi32(base, _mm256_add_epi32(row0, x1), 4);
+    const __m256i t01 = _mm256_i32gather_epi32(base, _mm256_add_epi32(row1, x0), 4);
+    const __m256i t11 = _mm256_i32gather_epi32(base, _mm256_add_epi32(row1, x1), 4);
+
+    for (int c = 0; c < 4; c++) {
+        const __m256 c00 = channelAvx2(t00, c), c10 = channelAvx2(t10, c);
+        const __m256 c01 = channelAvx2(t01, c), c11 = channelAvx2(t11, c);
+        const __m256 top = _mm256_add_ps(c00, _mm256_mul_ps(_mm256_sub_ps(c10, c00), weight_x));
+        const __m256 bottom = _mm256_add_ps(c01, _mm256_mul_ps(_mm256_sub_ps(c11, c01), weight_x));
+        _mm256_store_ps(channels[c], _mm256_add_ps(top, _mm256_mul_ps(_mm256_sub_ps(bottom, top), weight_y)));
+    }
+}
+
+/// Lanes of a row whose density is above their threshold, as a bit mask.
+__attribute__((target("avx2")))
+unsigned int densityMaskAvx2(const glm::vec4 &w, float bias, const Channels &channels, const float *thresholds) {
+    __m256 density = _mm256_mul_ps(_mm256_set1_ps(w.x), _mm256_load_ps(channels[0]));
+    density = _mm256_add_ps(density, _mm256_mul_ps(_mm256_set1_ps(w.y), _mm256_load_ps(channels[1])));
+    density = _mm256_add_ps(density, _mm256_mul_ps(_mm256_set1_ps(w.z), _mm256_load_ps(channels[2])));
+    density = _mm256_add_ps(density, _mm256_mul_ps(_mm256_set1_ps(w.w), _mm256_load_ps(channels[3])));
+    density = _mm256_add_ps(density, _mm256_set1_ps(bias));
+    return _mm256_movemask_ps(_mm256_cmp_ps(density, _mm256_load_ps(thresholds), _CMP_GT_OQ));
+}
+
+/// linearTapsAvx2() on 4 lanes.
+__attribute__((target("sse4.1")))
+__m128 linearTapsSse41(__m128 tex_coord, int size, __m128i &i0, __m128i &i1) {
+    const __m128 u = _mm_sub_ps(_mm_mul_ps(tex_coord, _mm_set1_ps(static_cast<float>(size))), _mm_set1_ps(0.5f));
+    const __m128 u0 = _mm_floor_ps(u);
+    const __m128 u0_clamped = _mm_min_ps(_mm_max_ps(u0, _mm_set1_ps(-1.0f)), _mm_set1_ps(static_cast<float>(size)));
+    const __m128i max_index = _mm_set1_epi32(size - 1);
+    const __m128i i = _mm_cvttps_epi32(u0_clamped);
+    i0 = _mm_max_epi32(_mm_min_epi32(i, max_index), _mm_setzero_si128());
+    i1 = _mm_max_epi32(_mm_min_epi32(_mm_add_epi32(i, _mm_set1_epi32(1)), max_index), _mm_setzero_si128());
+    return _mm_sub_ps(u, u0);
+}
+
+/// channelAvx2() on 4 texels.
+__attribute__((target("sse4.1")))
+__m128 channelSse41(__m128i texels, int c) {
+    const __m128i value = _mm_and_si128(_mm_srl_epi32(texels, _mm_cvtsi32_si128(8 * c)), _mm_set1_epi32(0xff));
+    return _mm_div_ps(_mm_cvtepi32_ps(value), _mm_set1_ps(255.0f));
+}
+
+/// Fetch the texels at 4 indices; there are no gathers before AVX2.
+__attribute__((target("sse4.1")))
+__m128i loadTexelsSse41(const std::uint32_t *texels, __m128i indices) {
+    alignas(16) int index[4];
+    _mm_store_si128(reinterpret_cast<__m128i *>(index), indices);
+    return _mm_setr_epi32(static_cast<int>(texels[index[0]]), static_cast<int>(texels[index[1]]),
+                          static_cast<int>(texels[index[2]]), static_cast<int>(texels[index[3]]));
+}
+
+/// sampleLanesAvx2() on the 4 lanes of a row from @p first.
+__attribute__((target("sse4.1")))
+void sampleLanesSse41(const std::uint32_t *texels, glm::ivec2 size, const float *tex_x, const float *tex_y,
+                      Channels &channels, int first) {
+    __m128i x0, x1, y0, y1;
+    const __m128 weight_x = linearTapsSse41(_mm_load_ps(tex_x + first), size.x, x0, x1);
+    const __m128 weight_y = linearTapsSse41(_mm_load_ps(tex_y + first), size.y, y0, y1);
+
+    const __m128i width = _mm_set1_epi32(size.x);
+    const __m128i row0 = _mm_mullo_epi32(y0, width);
+    const __m128i row1 = _mm_mullo_epi32(y1, width);
+    const __m128i t00 = loadTexelsSse41(texels, _mm_add_epi32(row0, x0));
+    const __m128i t10 = loadTexelsSse41(texels, _mm_add_epi32(row0, x1));
+    const __m128i t01 = loadTexelsSse41(texels, _mm_add_epi32(row1, x0));
+    const __m128i t11 = loadTexelsSse41(texels, _mm_add_epi32(row1, x1));
+
+    for (int c = 0; c < 4; c++) {
+        const __m128 c00 = channelSse41(t00, c), c10 = channelSse41(t10, c);
+        const __m128 c01 = channelSse41(t01, c), c11 = channelSse41(t11, c);
+        const __m128 top = _mm_add_ps(c00, _mm_mul_ps(_mm_sub_ps(c10, c00), weight_x));
+        const __m128 bottom = _mm_add_ps(c01, _mm_mul_ps(_mm_sub_ps(c11, c01), weight_x));
+        _mm_store_ps(channels[c] + first, _mm_add_ps(top, _mm_mul_ps(_mm_sub_ps(bottom, top), weight_y)));
+    }
+}
+
+/// densityMaskAvx2() on the 4 lanes from @p first, at their place in the mask.
+__attribute__((target("sse4.1")))
+unsigned int densityMaskSse41(const glm::vec4 &w, float bias, const Channels &channels, const float *thresholds,
+                              int first) {
+    __m128 density = _mm_mul_ps(_mm_set1_ps(w.x), _mm_load_ps(channels[0] + first));
+    density = _mm_add_ps(density, _mm_mul_ps(_mm_set1_ps(w.y), _mm_load_ps(channels[1] + first)));
+    density = _mm_add_ps(density, _mm_mul_ps(_mm_set1_ps(w.z), _mm_load_ps(channels[2] + first)));
+    density = _mm_add_ps(density, _mm_mul_ps(_mm_set1_ps(w.w), _mm_load_ps(channels[3] + first)));
+    density = _mm_add_ps(density, _mm_set1_ps(bias));
+    return static_cast<unsigned int>(_mm_movemask_ps(_mm_cmpgt_ps(density, _mm_load_ps(thresholds + first)))) << first;
+}
+
+#endif
+
+CpuPlacement::Kernel bestKernel() {
+#if CPU_PLACEMENT_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return CpuPlacement::Kernel::Avx2;
+    if (__builtin_cpu_supports("sse4.1"))
+        return CpuPlacement::Kernel::Sse41;
+#endif
+    return CpuPlacement::Kernel::Scalar;
+}
+
+} // namespace
+
+CpuPlacement::CpuPlacement(const Image &world_data)
+: m_size(world_data.dimensions()), m_texels(static_cast<std::size_t>(m_size.x) * m_size.y), m_kernel(bestKernel())
+{
+    const int channels = world_data.channels();
+    const unsigned char *data = world_data.data();
+
+    for (std::size_t i = 0; i < m_texels.size(); i++) {
+        std::uint32_t rgba[4] {0, 0, 0, 0xff};
+        for (int c = 0; c < channels; c++)
+            rgba[c] = data[i * channels + c];
+
+        m_texels[i] = rgba[0] | rgba[1] << 8 | rgba[2] << 16 | rgba[3] << 24;
+    }
+}
+
+void CpuPlacement::setTerrainDerivatives(glm::ivec2 size, std::vector<glm::vec4> texels) {
+    if (texels.size() != static_cast<std::size_t>(size.x) * size.y || texels.empty())
+        throw std::invalid_argument("CpuPlacement::setTerrainDerivatives: one texel per size.x * size.y is needed");
+
+    m_terrain_size = size;
+    m_terrain = std::move(texels);
+}
+
+glm::vec4 CpuPlacement::sample(glm::vec2 tex_coord) const {
+    const auto x = linearTaps(tex_coord.x, m_size.x);
+    const auto y = linearTaps(tex_coord.y, m_size.y);
+
+    const std::uint32_t t00 = m_texels[y.i0 * m_size.x + x.i0];
+    const std::uint32_t t10 = m_texels[y.i0 * m_size.x + x.i1];
+    const std::uint32_t t01 = m_texels[y.i1 * m_size.x + x.i0];
+    const std::uint32_t t11 = m_texels[y.i1 * m_size.x + x.i1];
+
+    glm::vec4 result;
+    for (int c = 0; c < 4; c++) {
+        const float top = unorm8(t00, c) + (unorm8(t10, c) - unorm8(t00, c)) * x.weight;
+        const float bottom = unorm8(t01, c) + (unorm8(t11, c) - unorm8(t01, c)) * x.weight;
+        result[c] = top + (bottom - top) * y.weight;
+    }
+    return result;
+}
+
+glm::vec4 CpuPlacement::sampleTerrain(glm::vec2 tex_coord) const {
+    const auto x = linearTaps(tex_coord.x, m_terrain_size.x);
+    const auto y = linearTaps(tex_coord.y, m_terrain_size.y);
+
+    const glm::vec4 &t00 = m_terrain[y.i0 * m_terrain_size.x + x.i0];
+    const glm::vec4 &t10 = m_terrain[y.i0 * m_terrain_size.x + x.i1];
+    const glm::vec4 &t01 = m_terrain[y.i1 * m_terrain_size.x + x.i0];
+    const glm::vec4 &t11 = m_terrain[y.i1 * m_terrain_size.x + x.i1];
+
+    const glm::vec4 top = t00 + (t10 - t00) * x.weight;
+    const glm::vec4 bottom = t01 + (t11 - t01) * x.weight;
+    return top + (bottom - top) * y.weight;
+}
+
+void CpuPlacement::sampleLanes(RowSamples &samples) const {
+    switch (m_kernel) {
+#if CPU_PLACEMENT_X86
+    case Kernel::Avx2:
+        sampleLanesAvx2(m_texels.data(), m_size, samples.tex_x, samples.tex_y, samples.channels);
+        return;
+    case Kernel::Sse41:
+        // two halves of the row
+        for (int half = 0; half < block_size; half += 4)
+            sampleLanesSse41(m_texels.data(), m_size, samples.tex_x, samples.tex_y, samples.channels, half);
+        return;
+#endif
+    default:
+        for (int lane = 0; lane < block_size; lane++) {
+            const glm::vec4 value = sample({samples.tex_x[lane], samples.tex_y[lane]});
+            for (int c = 0; c < 4; c++)
+                samples.channels[c][lane] = value[c];
+        }
+    }
+}
+
+void CpuPlacement::placeBlocks(const PlacementParameters &params, const PlacementParameters::CellRange &range,
+                               glm::ivec2 block_begin, glm::ivec2 block_end, Result &result) const {
+    if (params.mode != PlacementMode::Bayer)
+        throw std::logic_error("CpuPlacement only implements the Bayer placement mode");
+
+    result.resize(params.species.size());
+    const auto dither_size = static_cast<std::uint32_t>(params.dither_size);
+
+    // the derivatives are only sampled when a species restricts the slope or the curvature
+    const bool terrain_rules = std::any_of(params.species.begin(), params.species.end(), [](const Species &sp) {
+        return sp.min_slope > 0.0f || sp.max_slope < 1.0f || sp.min_curvature > std::numeric_limits<float>::lowest() ||
+               sp.max_curvature < std::numeric_limits<float>::max();
+    });
+
+    RowSamples samples {};
+    alignas(32) float thresholds[block_size];
+    glm::uvec2 cells[block_size];
+    bool in_range[block_size];
+    glm::vec4 derivatives[block_size] {};
+
+    for (int block_y = block_begin.y; block_y < block_end.y; block_y++) {
+        for (int block_x = block_begin.x; block_x < block_end.x; block_x++) {
+            for (int row = 0; row < block_size; row++) {
+                const int local_y = block_y * block_size + row;
+                if (local_y >= range.count.y)
+                    break;
+
+                // lanes past the end of the range are sampled like the others but never accepted
+                for (int lane = 0; lane < block_size; lane++) {
+                    const int local_x = block_x * block_size + lane;
+                    in_range[lane] = local_x < range.count.x;
+                    cells[lane] = glm::uvec2(range.first + glm::ivec2(local_x, local_y));
+
+                    samples.tex_x[lane] = (static_cast<float>(cells[lane].x) +
+                                           unitFloat(cellHash(cells[lane], params.seed, 0))) * params.candidate_spacing;
+                    samples.tex_y[lane] = (static_cast<float>(cells[lane].y) +
+                                           unitFloat(cellHash(cells[lane], params.seed, 1))) * params.candidate_spacing;
+                }
+
+                // the world data and the terrain derivatives are sampled once and shared by every species
+                sampleLanes(samples);
+                if (terrain_rules) {
+                    for (int lane = 0; lane < block_size; lane++)
+                        derivatives[lane] = sampleTerrain({samples.tex_x[lane], samples.tex_y[lane]});
+                }
+
+                for (std::size_t s = 0; s < params.species.size(); s++) {
+                    const Species &sp = params.species[s];
+                    const GLuint spacing = sp.spacing;
+
+                    for (int lane = 0; lane < block_size; lane++) {
+                        const glm::uvec2 cell = cells[lane];
+                        if (!in_range[lane] || cell.x % spacing != 0 || cell.y % spacing != 0 ||
+                            !sp.acceptsTerrain(samples.channels[0][lane], derivatives[lane].z, derivatives[lane].w)) {
+                            thresholds[lane] = std::numeric_limits<float>::infinity();
+                            continue;
+                        }
+
+                        const glm::uvec2 dither_id = (cell / spacing) % dither_size;
+                        const float dither = bayerThreshold(dither_id, dither_size) +
+                                unitFloat(cellHash(cell, params.seed, 2 + static_cast<std::uint32_t>(s))) /
+                                static_cast<float>(dither_size * dither_size);
+                        thresholds[lane] = std::max(sp.threshold, dither);
+                    }
+
+                    const glm::vec4 &w = sp.density_weights;
+                    unsigned int accepted_mask = 0;
+                    switch (m_kernel) {
+#if CPU_PLACEMENT_X86
+                    case Kernel::Avx2:
+                        accepted_mask = densityMaskAvx2(w, sp.density_bias, samples.channels, thresholds);
+                        break;
+                    case Kernel::Sse41:
+                        for (int half = 0; half < block_size; half += 4)
+                            accepted_mask |= densityMaskSse41(w, sp.density_bias, samples.channels, thresholds, half);
+                        break;
+#endif
+                    default:
+                        for (int lane = 0; lane < block_size; lane++) {
+                            float density = w.x * samples.channels[0][lane];
+                            density += w.y * samples.channels[1][lane];
+                            density += w.z * samples.channels[2][lane];
+                            density += w.w * samples.channels[3][lane];
+                            density += sp.density_bias;
+                            if (density > thresholds[lane])
+                                accepted_mask |= 1u << lane;
+                        }
+                    }
+
+                    for (int lane = 0; lane < block_size; lane++) {
+                        if (accepted_mask & (1u << lane)) {
+                            const glm::vec3 position {samples.tex_x[lane], samples.channels[0][lane],
+                                                      samples.tex_y[lane]};
+                            result[s].push_back({position, cellHash(cells[lane], params.seed, attribute_stream) >> 16});
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+void CpuPlacement::placeTile(const PlacementParameters &params, const PlacementParameters::CellRange &range, int tile,
+                             Result &result) const {
+    const glm::ivec2 tile_count = tileCount(range);
+    const glm::ivec2 block_begin = glm::ivec2(tile % tile_count.x, tile / tile_count.x) * tile_blocks;
+    const glm::ivec2 block_end = glm::min(block_begin + tile_blocks, blockCount(range));
+    placeBlocks(params, range, block_begin, block_end, result);
+}
+
+CpuPlacement::Result CpuPlacement::place(const PlacementParameters &params, glm::vec2 rect_pos0,
+                                         glm::vec2 rect_pos1) const {
+    const auto range = params.cellRange(rect_pos0, rect_pos1);
+    const glm::ivec2 tile_count = tileCount(range);
+
+    Result result(params.species.size());
+    for (int tile = 0; tile < tile_count.x * tile_count.y; tile++)
+        placeTile(params, range, tile, result);
+    return result;
+}
+
+CpuPlacement::Result CpuPlacement::place(const PlacementParameters &params, glm::vec2 rect_pos0, glm::vec2 rect_pos1,
+                                         ThreadPool &pool) const {
+    const auto range = params.cellRange(rect_pos0, rect_pos1);
+    const glm::ivec2 tile_count = tileCount(range);
+    std::vector<Result> tile_results(tile_count.x * tile_count.y);
+
+    std::vector<ThreadPool::Task> tasks;
+    for (std::size_t tile = 0; tile < tile_results.size(); tile++) {
+        tasks.emplace_back([this, &params, &range, tile, &tile_results] {
+            placeTile(params, range, static_cast<int>(tile), tile_results[tile]);
+        });
+    }
+    pool.run(std::move(tasks));
+
+    // the order only depends on the tiles, not on which thread placed them
+    Result result(params.species.size());
+    for (std::size_t s = 0; s < result.size(); s++) {
+        std::size_t count = 0;
+        for (const auto &tile_result : tile_results)
+            count += tile_result[s].size();
+
+        result[s].reserve(count);
+        for (const auto &tile_result : tile_results)
+            result[s].insert(result[s].end(), tile_result[s].begin(), tile_result[s].end());
+    }
+    return result;
+}
+
+CpuPlacement::Kernel CpuPlacement::kernel() const {
+    return m_kernel;
+}
+
+const char *CpuPlacement::kernelName(Kernel kernel) {
+    switch (kernel) {
+    case Kernel::Avx2:
+        return "AVX2";
+    case Kernel::Sse41:
+        return "SSE4.1";
+    default:
+        return "scalar";
+    }
+}
+
+glm::ivec2 CpuPlacement::blockCount(const PlacementParameters::CellRange &range) {
+    return (range.count + block_size - 1) / block_size;
+}
+
+glm::ivec2 CpuPlacement::tileCount(const PlacementParameters::CellRange &range) {
+    return (blockCount(range) + tile_blocks - 1) / tile_blocks;
+}
@@ -0,0 +1,127 @@
+#ifndef PROCEDURALPLACEMENT_CPU_PLACEMENT_HPP
+#define PROCEDURALPLACEMENT_CPU_PLACEMENT_HPP
+
+#include "placement_parameters.hpp"
+#include "thread_pool.hpp"
+
+#include "utils/image.hpp"
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief CPU implementation of the Bayer mode of placement.comp.
+ *
+ * Samples world_data like texture() does at level 0 (bilinear, clamped to the edge) and applies the same density,
+ * threshold, spacing and terrain rules, so its output can be compared against the GPU's or used where there is no GPU.
+ * Candidates are evaluated in square blocks, one row at a time with the best kernel the CPU supports, picked at run
+ * time: one AVX2 vector or two SSE4.1 vectors per row, scalar code otherwise. Blocks are grouped in square tiles, which
+ * are the unit of work when placing on several threads.
+ */
+class CpuPlacement {
+public:
+    /// Instruction set the rows of the blocks are evaluated with.
+    enum class Kernel {
+        Scalar,
+        Sse41,
+        Avx2,
+    };
+
+    /// Lanes of an AVX2 vector.
+    static constexpr int block_size = 8;
+
+    /// Blocks along each side of a tile.
+    static constexpr int tile_blocks = 8;
+
+    /// Entity accepted by the placement.
+    struct Entity {
+        /// Texture coordinates in x and z, world data height in y.
+        glm::vec3 position;
+        /// Attributes of its PackedInstance (yaw, scale and variant), hashed from its lattice cell like placement.comp.
+        GLuint attributes;
+    };
+
+    /// Entities accepted for each species.
+    using Result = std::vector<std::vector<Entity>>;
+
+    explicit CpuPlacement(const Image &world_data);
+
+    /**
+     * @brief Copy of Terrain::derivativeTexture() for the altitude, slope and curvature rules, @p size texels in
+     * row-major order. Until it is set the terrain is taken as flat.
+     */
+    void setTerrainDerivatives(glm::ivec2 size, std::vector<glm::vec4> texels);
+
+    /**
+     * @brief Place the entities of a rectangle.
+     * @param params Placement rules; only the Bayer mode is supported.
+     * @param rect_pos0, rect_pos1 Corners of the rectangle, in texture coordinates; see PlacementParameters::cellRange.
+     * @return Accepted entities of each species, ordered by tile, then by block within the tile, then row-major within
+     * the block.
+     */
+    [[nodiscard]] Result place(const PlacementParameters &params, glm::vec2 rect_pos0, glm::vec2 rect_pos1) const;
+
+    /**
+     * @brief Place the entities of a rectangle, one task per tile on @p pool.
+     *
+     * Each tile fills its own result and they are concatenated in tile order, so the output is the same as place()'s
+     * whatever the number of threads.
+     */
+    [[nodiscard]] Result place(const PlacementParameters &params, glm::vec2 rect_pos0, glm::vec2 rect_pos1,
+                               ThreadPool &pool) const;
+
+    /**
+     * @brief Place the entities of the blocks in [block_begin, block_end) of a cell range, appending them to @p result.
+     *
+     * Candidates only depend on their lattice cell, so splitting a range into block ranges doesn't change the output.
+     */
+    void placeBlocks(const PlacementParameters &params, const PlacementParameters::CellRange &range,
+                     glm::ivec2 block_begin, glm::ivec2 block_end, Result &result) const;
+
+    /// Number of blocks along each axis of a cell range.
+    [[nodiscard]] static glm::ivec2 blockCount(const PlacementParameters::CellRange &range);
+
+    /// Number of tiles along each axis of a cell range.
+    [[nodiscard]] static glm::ivec2 tileCount(const PlacementParameters::CellRange &range);
+
+    /// Kernel picked for this CPU.
+    [[nodiscard]] Kernel kernel() const;
+
+    [[nodiscard]] static const char *kernelName(Kernel kernel);
+
+    /// Sample world_data like texture() at level 0 with linear filtering and clamp-to-edge wrapping.
+    [[nodiscard]] glm::vec4 sample(glm::vec2 tex_coord) const;
+
+    /// Sample the terrain derivatives like texture() at level 0 with linear filtering and clamp-to-edge wrapping.
+    [[nodiscard]] glm::vec4 sampleTerrain(glm::vec2 tex_coord) const;
+
+private:
+
+    /// Texture coordinates and world_data samples of one row of a block.
+    struct RowSamples {
+        alignas(32) float tex_x[block_size];
+        alignas(32) float tex_y[block_size];
+        alignas(32) float channels[4][block_size];
+    };
+
+    /// Place the blocks of tile @p tile, in row-major tile order, appending them to @p result.
+    void placeTile(const PlacementParameters &params, const PlacementParameters::CellRange &range, int tile,
+                   Result &result) const;
+
+    /// Sample world_data at the texture coordinates of every lane.
+    void sampleLanes(RowSamples &samples) const;
+
+    glm::ivec2 m_size;
+    /// RGBA8 texels, with the channels missing from the image set like OpenGL does (0 for color, 1 for alpha).
+    std::vector<std::uint32_t> m_texels;
+    Kernel m_kernel;
+
+    glm::ivec2 m_terrain_size {1, 1};
+    std::vector<glm::vec4> m_terrain {glm::vec4(0.0f)};
+};
+
+#endif //PROCEDURALPLACEMENT_CPU_PLACEMENT_HPP
@@ -0,0 +1,69 @@
+#include "depth_pyramid.hpp"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+
+void DepthPyramid::build(glm::ivec2 size) {
+    size = glm::max(size, 1);
+    if (size != m_size)
+        resize(size);
+
+    // the default framebuffer's depth can't be sampled, but copies to a depth texture without drawing anything again
+    GL::Framebuffer::unbind(GL::Framebuffer::Target::Read);
+    glCopyTextureSubImage2D((*depth)->id(), 0, 0, 0, 0, 0, m_size.x, m_size.y);
+
+    glm::ivec3 work_group_size;
+    glGetProgramiv(reduce_program->id(), GL_COMPUTE_WORK_GROUP_SIZE, glm::value_ptr(work_group_size));
+
+    const auto id = reduce_program->id();
+    glProgramUniform1i(id, u_source_loc, source_tex_unit);
+    reduce_program->useProgram();
+
+    glm::ivec2 level_size = m_size;
+    for (GLint level = 0; level < m_levels; level++) {
+        glProgramUniform1i(id, u_copy_loc, level == 0);
+        glProgramUniform1i(id, u_source_level_loc, std::max(level - 1, 0));
+
+        // level 0 copies the depth buffer, the other levels reduce the one below them
+        glBindTextureUnit(source_tex_unit, level == 0 ? (*depth)->id() : (*pyramid)->id());
+        glBindImageTexture(destination_image_unit, (*pyramid)->id(), level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+
+        const glm::ivec2 groups = (level_size + glm::ivec2(work_group_size) - 1) / glm::ivec2(work_group_size);
+        glDispatchCompute(groups.x, groups.y, 1);
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+        level_size = glm::max(level_size / 2, 1);
+    }
+}
+
+GL::Texture DepthPyramid::texture() const {
+    return pyramid ? pyramid->handle() : GL::Texture();
+}
+
+glm::ivec2 DepthPyramid::size() const {
+    return m_size;
+}
+
+GLint DepthPyramid::levels() const {
+    return m_levels;
+}
+
+void DepthPyramid::resize(glm::ivec2 size) {
+    m_size = size;
+
+    // down to 1 x 1
+    m_levels = 1;
+    while ((std::max(size.x, size.y) >> m_levels) > 0)
+        m_levels++;
+
+    // the format of the default framebuffer's depth
+    depth.emplace(GL::Texture::Target::Tex2D);
+    (*depth)->storage2D(1, GL::Texture::InternalFormat::DepthComponent24, size.x, size.y);
+    (*depth)->setMinFilter(GL::Texture::MinFilter::Nearest);
+
+    pyramid.emplace(GL::Texture::Target::Tex2D);
+    (*pyramid)->storage2D(m_levels, GL::Texture::InternalFormat::R32F, size.x, size.y);
+    (*pyramid)->setMinFilter(GL::Texture::MinFilter::NearestMipmapNearest);
+    (*pyramid)->setMaxFilter(GL::Texture::MaxFilter::Nearest);
+}
@@ -0,0 +1,54 @@
+#ifndef PROCEDURALPLACEMENT_DEPTH_PYRAMID_HPP
+#define PROCEDURALPLACEMENT_DEPTH_PYRAMID_HPP
+
+#include "gl_utils/gl.hpp"
+
+#include "utils/shader_load.hpp"
+
+#include <glm/vec2.hpp>
+
+#include <optional>
+
+/**
+ * @brief Hierarchical depth buffer of the occluders drawn to the default framebuffer before build().
+ *
+ * build() copies the depth the frame's draws left and reduces it to a mipmapped R32F texture where each texel holds the
+ * farthest depth under its footprint. Anything nearer than that somewhere in its screen rectangle may be visible;
+ * anything behind it everywhere is hidden.
+ */
+class DepthPyramid {
+public:
+
+    /// Copy the depth of the default framebuffer, of @p size pixels, and reduce it to the pyramid.
+    void build(glm::ivec2 size);
+
+    /// Pyramid texture; empty before the first begin().
+    [[nodiscard]] GL::Texture texture() const;
+
+    [[nodiscard]] glm::ivec2 size() const;
+
+    [[nodiscard]] GLint levels() const;
+
+private:
+
+    void resize(glm::ivec2 size);
+
+    GL::ObjectManager<GL::ShaderProgram> reduce_program {loadComputeProgram("shaders/depth_pyramid.comp")};
+    GLint u_source_loc = reduce_program->getUniformLocation("u_source"),
+        u_source_level_loc = reduce_program->getUniformLocation("u_source_level"),
+        u_copy_loc = reduce_program->getUniformLocation("u_copy");
+
+    /// Unit 0 holds the world data for the whole frame.
+    static constexpr GLuint source_tex_unit = 1;
+    static constexpr GLuint destination_image_unit = 0;
+
+    /// Immutable storage, so both textures are recreated when the size changes.
+    std::optional<GL::ObjectManager<GL::Texture>> depth;
+    std::optional<GL::ObjectManager<GL::Texture>> pyramid;
+
+    glm::ivec2 m_size {0};
+    GLint m_levels {0};
+};
+
+
+#endif //PROCEDURALPLACEMENT_DEPTH_PYRAMID_HPP
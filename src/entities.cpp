@@ -1,100 +1,1408 @@
 #include "entities.hpp"
+#include "entity_meshes.hpp"
 
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/geometric.hpp>
 
 #include <imgui.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <string>
+#include <utility>
+
 
 Entities::Entities() {
-    glGetUniformfv(shader_program->id(), u_color_loc, glm::value_ptr(point_color));
-    glGetUniformfv(shader_program->id(), u_point_size_loc, &point_size);
+    loadPlacementProgram(work_group_tuner.find("placement.comp", placement_local_size));
+    uploadMeshes();
+    uploadSpecies();
+
+    vao->bindVertexBuffer(mesh_bind_index, mesh_vertex_buffer, 0, sizeof(Cube::Vertex));
+    vao->attribBinding(a_position_loc, mesh_bind_index);
+    vao->attribFormat(a_position_loc, 3, GL_FLOAT, false, offsetof(Cube::Vertex, position));
+    vao->enableAttrib(a_position_loc);
+    vao->attribBinding(a_normal_loc, mesh_bind_index);
+    vao->attribFormat(a_normal_loc, 3, GL_FLOAT, false, offsetof(Cube::Vertex, normal));
+    vao->enableAttrib(a_normal_loc);
+
+    // the instance buffer is bound before each draw, see update()
+    vao->bindingDivisor(instance_bind_index, 1);
+    vao->attribBinding(a_instance_loc, instance_bind_index);
+    vao->attribIFormat(a_instance_loc, 2, GL_UNSIGNED_INT, 0);
+    vao->enableAttrib(a_instance_loc);
+
+    vao->bindElementBuffer(mesh_element_buffer);
+
+    // one per placement set, so that a background generation never shares it with the placements of the current set
+    constexpr GLuint empty = 0;
+    for (auto *texture : {&current_set.occupancy_texture, &pending_set.occupancy_texture}) {
+        (*texture)->storage2D(1, GL::Texture::InternalFormat::R32UI, occupancy_size, occupancy_size);
+        (*texture)->clearSubImage2D(0, 0, 0, occupancy_size, occupancy_size, GL::Texture::Format::RedInt,
+                                    GL::Texture::Type::UInt, &empty);
+    }
 }
 
-void Entities::setParentTransform(const glm::mat4 &matrix) const {
+void Entities::setParentTransform(const glm::mat4 &matrix) {
+    parent_transform = matrix;
     glProgramUniformMatrix4fv(shader_program->id(), u_model_loc, 1, false, glm::value_ptr(matrix));
+    glProgramUniformMatrix4fv(compute_program->id(), u_compute_model_loc, 1, false, glm::value_ptr(matrix));
 }
 
-void Entities::setViewMatrix(const glm::mat4 &matrix) const {
+void Entities::setViewMatrix(const glm::mat4 &matrix) {
+    view_matrix = matrix;
     glProgramUniformMatrix4fv(shader_program->id(), u_view_loc, 1, false, glm::value_ptr(matrix));
 }
 
-void Entities::setProjMatrix(const glm::mat4 &matrix) const {
+void Entities::setProjMatrix(const glm::mat4 &matrix) {
+    proj_matrix = matrix;
     glProgramUniformMatrix4fv(shader_program->id(), u_proj_loc, 1, false, glm::value_ptr(matrix));
 }
 
-void Entities::setWorldDataTexUnit(GLint unit) const {
+void Entities::setWorldDataTexUnit(GLint unit) {
+    world_data_tex_unit = unit;
     glProgramUniform1i(compute_program->id(), u_world_data_loc, unit);
+    glProgramUniform1i(poisson_program->id(), u_poisson_world_data_loc, unit);
+}
+
+void Entities::setTerrainDerivatives(GL::Texture texture, GLint unit) {
+    terrain_derivatives_tex_unit = unit;
+    glProgramUniform1i(compute_program->id(), u_terrain_derivatives_loc, unit);
+    glProgramUniform1i(poisson_program->id(), u_poisson_terrain_derivatives_loc, unit);
+
+    if (cpu_placement) {
+        glm::ivec2 size;
+        glGetTextureLevelParameteriv(texture.id(), 0, GL_TEXTURE_WIDTH, &size.x);
+        glGetTextureLevelParameteriv(texture.id(), 0, GL_TEXTURE_HEIGHT, &size.y);
+        std::vector<glm::vec4> texels(static_cast<std::size_t>(size.x) * size.y);
+        glGetTextureImage(texture.id(), 0, GL_RGBA, GL_FLOAT, static_cast<GLsizei>(texels.size() * sizeof(glm::vec4)),
+                          texels.data());
+        cpu_placement->setTerrainDerivatives(size, std::move(texels));
+    }
 }
 
-void Entities::update() {
+void Entities::setDepthPyramid(const DepthPyramid *pyramid) {
+    depth_pyramid = pyramid;
+}
+
+bool Entities::occlusionCulling() const {
+    return culling && occlusion && depth_pyramid;
+}
+
+void Entities::setWorldData(const Image &world_data) {
+    cpu_placement.emplace(world_data);
+}
+
+void Entities::uploadMeshes() {
+    std::vector<Cube::Vertex> vertices;
+    std::vector<GLuint> indices;
+
+    // in EntityMesh order
+    const auto add_mesh = [&](const auto &mesh_vertices, const auto &mesh_indices) {
+        float radius = 0.0f;
+        for (const auto &vertex : mesh_vertices)
+            radius = std::max(radius, glm::length(vertex.position));
+
+        meshes.push_back({static_cast<GLuint>(std::size(mesh_indices)), static_cast<GLuint>(indices.size()),
+                          static_cast<GLint>(vertices.size()), radius});
+        vertices.insert(vertices.end(), std::begin(mesh_vertices), std::end(mesh_vertices));
+        indices.insert(indices.end(), std::begin(mesh_indices), std::end(mesh_indices));
+    };
+    add_mesh(Cube::cube_vertices, Cube::cube_indices);
+    add_mesh(CrossedQuads::vertices, CrossedQuads::indices);
+
+    mesh_vertex_buffer->initialize(vertices, GL::Buffer::Usage::StaticDraw);
+    mesh_element_buffer->initialize(indices, GL::Buffer::Usage::StaticDraw);
+}
+
+void Entities::loadPlacementProgram(glm::ivec2 local_size) {
+    placement_local_size = local_size;
+    auto defines = WorkGroupTuner::defines(local_size);
+    defines.emplace_back("DITHER_SIZE", std::to_string(params.dither_size));
+    compute_program = GL::ObjectManager<GL::ShaderProgram>(loadComputeProgram("shaders/placement.comp", defines));
+
+    u_world_data_loc = compute_program->getUniformLocation("u_world_data");
+    u_terrain_derivatives_loc = compute_program->getUniformLocation("u_terrain_derivatives");
+    u_first_cell_loc = compute_program->getUniformLocation("u_first_cell");
+    u_cell_count_loc = compute_program->getUniformLocation("u_cell_count");
+    u_cell_size_loc = compute_program->getUniformLocation("u_cell_size");
+    u_seed_loc = compute_program->getUniformLocation("u_seed");
+    u_lod_distance_loc = compute_program->getUniformLocation("u_lod_distance");
+    u_camera_position_loc = compute_program->getUniformLocation("u_camera_position");
+    u_compute_model_loc = compute_program->getUniformLocation("u_model");
+    u_species_count_loc = compute_program->getUniformLocation("u_species_count");
+    u_command_offset_loc = compute_program->getUniformLocation("u_command_offset");
+    u_command_capacity_loc = compute_program->getUniformLocation("u_command_capacity");
+    u_exclusion_level_loc = compute_program->getUniformLocation("u_exclusion_level");
+    u_margin_cells_loc = compute_program->getUniformLocation("u_margin_cells");
+    u_valid_first_loc = compute_program->getUniformLocation("u_valid_first");
+    u_valid_end_loc = compute_program->getUniformLocation("u_valid_end");
+
+    // the uniforms that aren't set before every dispatch
+    glProgramUniform1i(compute_program->id(), u_world_data_loc, world_data_tex_unit);
+    glProgramUniform1i(compute_program->id(), u_terrain_derivatives_loc, terrain_derivatives_tex_unit);
+    glProgramUniformMatrix4fv(compute_program->id(), u_compute_model_loc, 1, false, glm::value_ptr(parent_transform));
+}
+
+void Entities::uploadSpecies() {
+    for (auto &sp : params.species)
+        sp.bounding_radius = meshes[static_cast<GLuint>(sp.mesh)].radius * sp.mesh_scale * (1.0f + sp.scale_variation);
+
+    // exclusion levels rank the distinct priorities, the highest first
+    std::vector<GLint> priorities;
+    for (const auto &sp : params.species)
+        priorities.push_back(sp.priority);
+    std::sort(priorities.begin(), priorities.end(), std::greater<>());
+    priorities.erase(std::unique(priorities.begin(), priorities.end()), priorities.end());
+
+    std::vector<float> footprints(priorities.size(), 0.0f);
+    for (auto &sp : params.species) {
+        sp.footprint = std::max(sp.footprint, 0.0f);
+        sp.exclusion_level = static_cast<GLuint>(
+                std::find(priorities.begin(), priorities.end(), sp.priority) - priorities.begin());
+        footprints[sp.exclusion_level] = std::max(footprints[sp.exclusion_level], sp.footprint);
+    }
+
+    // a level stamps past its range as far as its footprints can reach a candidate of the next levels' margins
+    exclusion_margins.assign(priorities.size(), 0.0f);
+    exclusion_reach = 0.0f;
+    float margin_below = 0.0f;
+    for (std::size_t level = priorities.size(); level-- > 0;) {
+        if (footprints[level] > 0.0f && level + 1 < priorities.size())
+            exclusion_margins[level] = footprints[level] + margin_below;
+        margin_below = std::max(margin_below, exclusion_margins[level]);
+        if (level + 1 < priorities.size())
+            exclusion_reach = std::max(exclusion_reach, exclusion_margins[level] + footprints[level]);
+    }
+
+    species_buffer->initialize(params.species, GL::Buffer::Usage::DynamicDraw);
+}
+
+void Entities::update(const Camera &camera) {
     ImGui::Text("Placement");
 
-    ImGui::InputFloat2("Pos0", glm::value_ptr(pos0));
-    ImGui::InputFloat2("Pos1", glm::value_ptr(pos1));
-    ImGui::InputInt2("Placement Work Groups", glm::value_ptr(num_work_groups));
-    ImGui::Text("WorkGroup: 4 x 4 invocations.");
-    if (ImGui::Button("Compute placement")) {
-        pos0 = glm::min(pos0, pos1);
-        pos1 = glm::max(pos0, pos1);
-        num_work_groups = glm::max(num_work_groups, 1);
+    bool rect_changed = ImGui::InputFloat2("Pos0", glm::value_ptr(params.pos0));
+    rect_changed |= ImGui::InputFloat2("Pos1", glm::value_ptr(params.pos1));
+    // cellRange() divides by it, and the output ranges are sized for it: it is clamped as it is typed, and laid out
+    // once the field is left rather than on every keystroke
+    if (ImGui::InputFloat("Candidate spacing", &params.candidate_spacing, 0.0f, 0.0f, "%.5f"))
+        params.candidate_spacing = std::max(params.candidate_spacing, 1e-4f);
+    if (ImGui::IsItemDeactivatedAfterEdit())
+        generateEntities();
+    int seed = static_cast<int>(params.seed);
+    if (ImGui::InputInt("Seed", &seed))
+        params.seed = static_cast<GLuint>(seed);
+
+    static constexpr const char *mode_names[] {"Bayer", "Poisson disk"};
+    // the Bayer ranges are sized for the lattice cells, the Poisson ones for the cells of each species' grid
+    if (ImGui::Combo("Mode", reinterpret_cast<int *>(&params.mode), mode_names, 2))
         generateEntities();
+    if (params.mode == PlacementMode::PoissonDisk)
+        ImGui::InputInt("Trials per cell", &params.poisson_trials);
+
+    bool lod_changed = false;
+    if (params.mode == PlacementMode::Bayer) {
+        static constexpr int dither_sizes[] {2, 4, 8, 16};
+        static constexpr const char *dither_names[] {"2x2", "4x4", "8x8", "16x16"};
+        int dither_index = static_cast<int>(std::find(std::begin(dither_sizes), std::end(dither_sizes),
+                                                      params.dither_size) - std::begin(dither_sizes));
+        if (ImGui::Combo("Dither matrix", &dither_index, dither_names, 4)) {
+            params.dither_size = dither_sizes[dither_index];
+            loadPlacementProgram(placement_local_size);
+            regeneratePlacement();
+        }
+
+        lod_changed |= ImGui::Checkbox("Distance LOD", &lod);
+        if (lod) {
+            lod_changed |= ImGui::InputFloat("LOD distance", &lod_distance);
+            ImGui::InputFloat("LOD update distance", &lod_update_distance);
+        }
+    }
+
+    // the tile layout is only applied once its field is left, rather than generating a placement per keystroke; the
+    // current set streams with the one it was generated with until then
+    bool layout_changed = ImGui::Checkbox("Tiles around camera", &tiled);
+    ImGui::InputFloat("Tile size", &tile_size);
+    layout_changed |= ImGui::IsItemDeactivatedAfterEdit();
+    ImGui::InputInt("Tile slots", &tile_slots);
+    layout_changed |= ImGui::IsItemDeactivatedAfterEdit();
+    if (tiled) {
+        ImGui::InputInt("Tile radius", &tile_radius);
+        layout_changed |= ImGui::IsItemDeactivatedAfterEdit();
+    }
+    // also the budget of the background generation in fixed mode
+    ImGui::InputInt("Tiles per frame", &tiles_per_frame);
+    ImGui::Text("Cached tiles: %d / %d", static_cast<int>(current_set.tile_cache.size()),
+                current_set.tile_cache.slotCount());
+
+    ImGui::Text("Capacity: %d points", current_set.max_point_count);
+    if (ImGui::Button("Compute placement") || layout_changed) {
+        generateEntitiesInBackground();
+    } else if (rect_changed && !current_set.tiled) {
+        // only the tiles along the edges that moved are placed again, unless a whole new placement is on its way
+        if (pending_generation)
+            generateEntitiesInBackground();
+        else
+            updateFixedTiles();
+    }
+    if (pending_generation)
+        ImGui::Text("Generating...");
+
+    ImGui::Checkbox("Frustum culling", &culling);
+    if (culling) {
+        if (depth_pyramid)
+            ImGui::Checkbox("Occlusion culling", &occlusion);
+        ImGui::Checkbox("Culling stats", &culling_stats);
+        if (culling_stats && placed_count > 0) {
+            ImGui::Text("Visible: %llu / %llu (%.1f%% culled)", static_cast<unsigned long long>(visible_count),
+                        static_cast<unsigned long long>(placed_count),
+                        100.0 * static_cast<double>(placed_count - visible_count) / static_cast<double>(placed_count));
+        }
     }
 
-    if (ImGui::InputFloat("Point Size", &point_size)) {
-        glProgramUniform1f(shader_program->id(), u_point_size_loc, point_size);
+    static constexpr const char *mesh_names[] {"Cube", "Crossed quads"};
+
+    // edits of how the species are drawn, of which candidates they accept, and of the size of their output ranges
+    bool species_changed = false;
+    bool acceptance_changed = false;
+    bool capacity_changed = false;
+    bool species_count_changed = false;
+    bool mesh_changed = false;
+    bool exclusion_changed = false;
+    for (std::size_t i = 0; i < params.species.size(); i++) {
+        auto &sp = params.species[i];
+        ImGui::PushID(static_cast<int>(i));
+        if (ImGui::TreeNode("Species", "Species %d", static_cast<int>(i))) {
+            acceptance_changed |= ImGui::DragFloat4("Density Weights", glm::value_ptr(sp.density_weights), 0.01f);
+            acceptance_changed |= ImGui::DragFloat("Density Bias", &sp.density_bias, 0.01f);
+            acceptance_changed |= ImGui::DragFloat("Threshold", &sp.threshold, 0.01f, 0.0f, 1.0f);
+
+            int spacing = static_cast<int>(sp.spacing);
+            if (ImGui::InputInt("Spacing", &spacing)) {
+                sp.spacing = glm::max(spacing, 1);
+                capacity_changed = true;
+            }
+
+            // sizes the Poisson grid, which is laid out again once the drag is over
+            species_changed |= ImGui::DragFloat("Min Distance", &sp.min_distance, 0.0005f, 0.0001f, 1.0f, "%.4f");
+            capacity_changed |= ImGui::IsItemDeactivatedAfterEdit() && params.mode == PlacementMode::PoissonDisk;
+
+            species_changed |= ImGui::ColorEdit4("Color", glm::value_ptr(sp.color));
+
+            mesh_changed |= ImGui::Combo("Mesh", reinterpret_cast<int *>(&sp.mesh), mesh_names, 2);
+            species_changed |= ImGui::DragFloat("Mesh Scale", &sp.mesh_scale, 0.001f, 0.001f, 1.0f, "%.3f");
+            species_changed |= ImGui::DragFloat("Scale Variation", &sp.scale_variation, 0.01f, 0.0f, 0.9f);
+
+            acceptance_changed |= ImGui::DragFloatRange2("Altitude", &sp.min_altitude, &sp.max_altitude, 0.005f,
+                                                         0.0f, 1.0f);
+            acceptance_changed |= ImGui::DragFloatRange2("Slope", &sp.min_slope, &sp.max_slope, 0.005f, 0.0f, 1.0f);
+            acceptance_changed |= ImGui::DragFloatRange2("Curvature", &sp.min_curvature, &sp.max_curvature, 0.05f,
+                                                         std::numeric_limits<float>::lowest(),
+                                                         std::numeric_limits<float>::max(), "%.3g");
+
+            exclusion_changed |= ImGui::InputInt("Priority", &sp.priority);
+            exclusion_changed |= ImGui::DragFloat("Footprint", &sp.footprint, 0.0005f, 0.0f, 0.1f, "%.4f");
+            ImGui::TreePop();
+        }
+        ImGui::PopID();
     }
 
-    if (ImGui::ColorEdit4("Point Color", glm::value_ptr(point_color))) {
-        glProgramUniform4fv(shader_program->id(), u_color_loc, 1, glm::value_ptr(point_color));
+    if (params.species.size() < PlacementParameters::max_species && ImGui::Button("Add species")) {
+        params.species.push_back(params.species.back());
+        species_count_changed = true;
     }
+    if (params.species.size() > 1 && ImGui::Button("Remove species")) {
+        params.species.pop_back();
+        species_count_changed = true;
+    }
+
+    exclusion_changed |= ImGui::Checkbox("Cross-species exclusion", &exclusion);
+
+    if (species_changed || acceptance_changed || capacity_changed || species_count_changed || mesh_changed ||
+        exclusion_changed)
+        uploadSpecies();
+
+    // the draw commands are laid out per species, with the index range of its mesh and a range sized for its spacing
+    // or Poisson grid, and the Poisson halos are sized for the exclusion levels; the cached tiles follow the other
+    // rules, like the tiles streamed from now on
+    if (capacity_changed || species_count_changed || mesh_changed ||
+        (exclusion_changed && params.mode == PlacementMode::PoissonDisk))
+        generateEntities();
+    else if (acceptance_changed || exclusion_changed)
+        regeneratePlacement();
+
+    ImGui::InputInt("Benchmark runs", &benchmark_runs);
+    if (ImGui::Button("Benchmark placement modes")) {
+        benchmark_runs = std::max(benchmark_runs, 1);
+        benchmark();
+    }
+    for (const auto &result : benchmark_results) {
+        ImGui::Text("%s: %.3f ms, %.1f M candidates/s, %llu placed",
+                    mode_names[static_cast<int>(result.mode)],
+                    result.milliseconds,
+                    static_cast<double>(result.candidates) / (result.milliseconds * 1e3),
+                    static_cast<unsigned long long>(result.placed));
+    }
+
+    ImGui::Text("Placement work group: %dx%d", placement_local_size.x, placement_local_size.y);
+    if (ImGui::Button("Autotune work group size")) {
+        benchmark_runs = std::max(benchmark_runs, 1);
+        autotune();
+    }
+    for (const auto &timing : autotune_results)
+        ImGui::Text("  %dx%d: %.3f ms", timing.local_size.x, timing.local_size.y, timing.milliseconds);
+
+    // the CPU placement only implements the Bayer mode
+    if (ImGui::InputInt("CPU threads", &cpu_threads)) {
+        cpu_threads = std::max(cpu_threads, 0);
+        cpu_pool.reset();
+    }
+    if (cpu_placement && ImGui::Checkbox("Place on CPU", &cpu_streaming))
+        regeneratePlacement();
+    if (cpu_placement)
+        ImGui::Text("CPU kernel: %s", CpuPlacement::kernelName(cpu_placement->kernel()));
+    // the CPU placement only implements the Bayer mode, without the camera dependent LOD nor exclusion
+    if (cpu_placement && !tiled && !lodActive() && !exclusionActive() && params.mode == PlacementMode::Bayer &&
+        ImGui::Button("Validate against CPU"))
+        validateCpuPlacement();
+    for (std::size_t s = 0; s < validation_results.size(); s++) {
+        const auto &result = validation_results[s];
+        ImGui::Text("Species %d: %s, GPU %u, CPU %u (%.3f ms), unmatched %u GPU / %u CPU, %u attributes differ, "
+                    "height error %g", static_cast<int>(s), result.matches() ? "match" : "MISMATCH", result.gpu_count,
+                    result.cpu_count, result.cpu_milliseconds, result.unmatched_gpu, result.unmatched_cpu,
+                    result.attribute_mismatches, result.max_height_error);
+    }
+
+    // the thinning depends on the camera, so the placement follows it once it has moved far enough
+    if (lod_changed || (lodActive() && glm::distance(camera.eye(), lod_camera_position) > lod_update_distance)) {
+        lod_distance = std::max(lod_distance, 1e-3f);
+        lod_camera_position = camera.eye();
+        // queued like the streaming, rather than placing every cached tile again in this frame
+        for (const auto &entry : current_set.tile_cache.entries())
+            current_set.stale_slots.insert(static_cast<GLuint>(entry.slot));
+        if (pending_generation) {
+            for (const auto &entry : pending_set.tile_cache.entries())
+                pending_set.stale_slots.insert(static_cast<GLuint>(entry.slot));
+        }
+    }
+
+    // the background generation queues a few tiles per frame like the streaming, so that no frame queues all of them
+    if (pending_generation && !pending_fence) {
+        swapPlacementSet();
+        const auto budget = static_cast<std::size_t>(tiles_per_frame);
+        const std::size_t left = current_set.tiled ? updateTiles(camera) : placeFixedTiles(budget);
+        swapPlacementSet();
+        if (left == 0)
+            pending_fence.emplace();
+    }
+    // and replaces the drawn entities once the GPU is done with its last tile
+    if (pending_fence && (*pending_fence)->signaled()) {
+        swapPlacementSet();
+        pending_fence.reset();
+        pending_generation = false;
+    }
+
+    if (current_set.tiled)
+        updateTiles(camera);
 
-    if (point_count > 0) {
+    regenerateDirtyTiles();
+    regenerateStaleTiles(static_cast<std::size_t>(tiles_per_frame));
+
+    if (ImGui::Checkbox("Spatial index", &spatial_indexing) && spatial_indexing) {
+        // the slots placed while it was off
+        current_set.spatial_index.clear();
+        for (const auto &entry : current_set.tile_cache.entries())
+            current_set.unindexed_slots.insert(entry.slot);
+    }
+    if (spatial_indexing) {
+        updateSpatialIndex();
+        ImGui::Text("Indexed: %zu entities", current_set.spatial_index.size());
+
+        // around the camera, in the texture coordinates the entities are placed in
+        const glm::vec4 eye = glm::inverse(parent_transform) * glm::vec4(camera.eye(), 1.0f);
+        const glm::vec2 point {eye.x, eye.z};
+        ImGui::DragFloat("Query radius", &query_radius, 0.001f, 0.0f, 1.0f, "%.3f");
+        SpatialIndex::Results within;
+        current_set.spatial_index.radius({&point, 1}, query_radius, within);
+        SpatialIndex::Results nearest;
+        current_set.spatial_index.nearest({&point, 1}, 1, nearest);
+        ImGui::Text("Within radius of the camera: %zu", within[0].size());
+        if (!nearest[0].empty()) {
+            const auto &hit = nearest[0].front();
+            ImGui::Text("Nearest: species %u at %.4f", hit.species,
+                        glm::distance(point, glm::vec2(hit.position.x, hit.position.z)));
+        }
+    }
+    if (ImGui::Button("Benchmark spatial index"))
+        benchmarkSpatialIndex();
+    if (spatial_index_benchmark) {
+        const auto &result = *spatial_index_benchmark;
+        ImGui::Text("%zu entities built in %.1f ms", result.entities, result.build_milliseconds);
+        ImGui::Text("%zu queries: radius %.1f ms (%.1f hits each), box %.1f ms, 8 nearest %.1f ms", result.queries,
+                    result.radius_milliseconds, result.hits_per_radius_query, result.box_milliseconds,
+                    result.nearest_milliseconds);
+    }
+
+    if (current_set.command_count > 0) {
+        if (culling)
+            cullEntities();
+
+        // the culling output keeps the ranges of the placement output, so only the source buffers change; each
+        // command reads its entities from base_instance on
+        const auto &instances = culling ? current_set.visible_buffer : current_set.buffer;
+        vao->bindVertexBuffer(instance_bind_index, instances, 0, sizeof(PackedInstance));
+
+        glProgramUniform1ui(shader_program->id(), u_draw_species_count_loc, static_cast<GLuint>(params.species.size()));
         shader_program->useProgram();
         vao->bind();
-        glDrawArrays(GL_POINTS, 0, point_count);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, species_binding, species_buffer->id());
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, instance_rect_binding, current_set.rect_buffer->id());
+        const auto &commands = culling ? current_set.visible_command_buffer : current_set.command_buffer;
+        commands->bind(GL::Buffer::Target::DrawIndirect);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, current_set.command_count, 0);
     }
 }
 
 void Entities::generateEntities() {
-    auto tex_offset = pos0;
-    auto tex_scale = pos1 - pos0;
-    glProgramUniform2f(compute_program->id(), u_tex_coord_offset_loc, tex_offset.x, tex_offset.y);
-    glProgramUniform2f(compute_program->id(), u_tex_coord_scale_loc, tex_scale.x, tex_scale.y);
+    // whatever was being generated in the background is out of date
+    pending_generation = false;
+    pending_fence.reset();
 
-    glm::ivec3 work_group_size;
-    glGetProgramiv(compute_program->id(), GL_COMPUTE_WORK_GROUP_SIZE, glm::value_ptr(work_group_size));
-    const glm::uvec2 num_compute_threads = num_work_groups * glm::ivec2(work_group_size);
+    layoutPlacement();
+    if (!current_set.tiled)
+        updateFixedTiles();
+}
+
+void Entities::layoutPlacement() {
+    PlacementSet &set = current_set;
+    params.poisson_trials = std::max(params.poisson_trials, 1);
+    params.pos0 = glm::min(params.pos0, params.pos1);
+    params.pos1 = glm::max(params.pos0, params.pos1);
+    tile_size = std::max(tile_size, 1e-3f);
+    tiles_per_frame = std::max(tiles_per_frame, 1);
+
+    if (tiled) {
+        tile_radius = std::max(tile_radius, 0);
+
+        // every tile around the camera must fit, so that they never evict each other
+        const int tile_diameter = 2 * tile_radius + 1;
+        tile_slots = std::max(tile_slots, tile_diameter * tile_diameter);
+    } else {
+        const glm::ivec2 tiles = glm::ceil(params.pos1 / tile_size) - glm::floor(params.pos0 / tile_size);
+        tile_slots = std::max(tile_slots, tiles.x * tiles.y);
+    }
+
+    // the set keeps the layout it was generated with, whatever is typed in the UI until the next generation
+    set.tiled = tiled;
+    set.tile_size = tile_size;
+    set.tile_radius = tile_radius;
+
+    layoutCommands(glm::vec2(tile_size));
+    allocateSlots(tile_slots);
+    set.tile_cache = TileCache(tile_slots);
+    set.slot_rects.assign(tile_slots, PlacementRect {glm::vec2(0.0f), glm::vec2(0.0f)});
+    set.dirty_rects.clear();
+    set.spatial_index.clear();
+    set.stale_slots.clear();
+    set.unindexed_slots.clear();
+    set.readback_slots.clear();
+    set.readback_fence.reset();
+}
+
+void Entities::generateEntitiesInBackground() {
+    // the previous set may still be read by the draws in flight, which reallocating it doesn't wait for; its tiles are
+    // placed by update()
+    swapPlacementSet();
+    layoutPlacement();
+    swapPlacementSet();
+    pending_generation = true;
+    pending_fence.reset();
+}
+
+void Entities::swapPlacementSet() {
+    std::swap(current_set, pending_set);
+}
+
+const SpatialIndex &Entities::spatialIndex() const {
+    return current_set.spatial_index;
+}
+
+void Entities::updateSpatialIndex() {
+    PlacementSet &set = current_set;
+    // reading back a slot the GPU is still placing would wait for it, so the slots are read a call after a fence
+    // queued behind them, once it has signaled
+    if (!set.readback_fence) {
+        if (!set.unindexed_slots.empty()) {
+            set.readback_slots = std::move(set.unindexed_slots);
+            set.unindexed_slots.clear();
+            set.readback_fence.emplace();
+        }
+        return;
+    }
+    if (!(*set.readback_fence)->signaled())
+        return;
+    set.readback_fence.reset();
+
+    const std::size_t species_count = set.slot_commands.size();
+    std::vector<DrawElementsIndirectCommand> commands(species_count);
+    std::vector<PackedInstance> instances;
+    std::vector<glm::vec3> positions;
+    std::vector<std::uint32_t> species;
+    for (const GLuint slot : set.readback_slots) {
+        // placed again since, so read with the next fence
+        if (set.unindexed_slots.contains(slot))
+            continue;
+
+        InstanceRect rect {};
+        set.command_buffer->readData(static_cast<GLintptr>(slot * species_count * sizeof(DrawElementsIndirectCommand)),
+                                     static_cast<GLsizeiptr>(species_count * sizeof(DrawElementsIndirectCommand)),
+                                     commands.data());
+        set.rect_buffer->readData(slot * sizeof(InstanceRect), sizeof(InstanceRect), &rect);
+
+        positions.clear();
+        species.clear();
+        for (std::size_t s = 0; s < species_count; s++) {
+            instances.resize(commands[s].instance_count);
+            if (instances.empty())
+                continue;
+            set.buffer->readData(static_cast<GLintptr>(commands[s].base_instance) * sizeof(PackedInstance),
+                                 static_cast<GLsizeiptr>(instances.size()) * sizeof(PackedInstance), instances.data());
+            for (const auto &instance : instances) {
+                positions.push_back(instance.position(rect));
+                species.push_back(static_cast<std::uint32_t>(s));
+            }
+        }
+        set.spatial_index.setTile(static_cast<int>(slot), positions, species);
+    }
+    set.readback_slots.clear();
+}
+
+void Entities::markDirty(glm::vec2 pos0, glm::vec2 pos1) {
+    current_set.dirty_rects.push_back({glm::min(pos0, pos1), glm::max(pos0, pos1)});
+    // the pending placement may have been generated before the change
+    if (pending_generation)
+        pending_set.dirty_rects.push_back(current_set.dirty_rects.back());
+}
+
+void Entities::layoutCommands(glm::vec2 size) {
+    PlacementSet &set = current_set;
+    const glm::ivec2 max_cells = params.maxCellCount(size);
+
+    // each species gets its own range of the point buffer, sized for the candidates it may accept
+    set.slot_commands.clear();
+    set.command_capacities.clear();
+    set.poisson_grids.clear();
+    set.command_capacity = 0;
+    GLuint max_points = 0;
+    for (const auto &sp : params.species) {
+        glm::ivec2 species_capacity;
+
+        if (params.mode == PlacementMode::Bayer) {
+            const auto spacing = static_cast<int>(sp.spacing);
+            species_capacity = (max_cells + spacing - 1) / spacing;
+        } else {
+            float cell_size = sp.min_distance / std::sqrt(2.0f);
+            cell_size = std::max(cell_size, std::max(size.x, size.y) / max_poisson_cells);
+
+            // the corners of the lattice cells in a tile, whichever way the tile is aligned with the lattice
+            const glm::ivec2 cell_count = glm::ivec2(glm::ceil(size / cell_size)) + 1;
+            set.poisson_grids.push_back({cell_count, cell_size, poisson_dependency_cells});
+
+            // at most one entity per cell
+            species_capacity = cell_count;
+        }
+
+        const auto &mesh = meshes[static_cast<GLuint>(sp.mesh)];
+        set.slot_commands.push_back({mesh.index_count, 0, mesh.first_index, mesh.base_vertex, max_points});
+        const auto capacity = static_cast<GLuint>(species_capacity.x * species_capacity.y);
+        max_points += capacity;
+        set.command_capacities.push_back(capacity);
+        set.command_capacity = std::max(set.command_capacity, capacity);
+    }
+
+    if (params.mode == PlacementMode::PoissonDisk)
+        layoutPoissonHalos();
+
+    set.slot_capacity = max_points;
+}
+
+void Entities::layoutPoissonHalos() {
+    PlacementSet &set = current_set;
+    const bool exclude = exclusionActive();
+    const std::size_t levels = exclusion_margins.size();
+    std::vector<float> footprints(levels, 0.0f);
+    std::vector<float> dependencies(levels, 0.0f);
+    float max_cell_size = 0.0f;
+    for (std::size_t s = 0; s < set.poisson_grids.size(); s++) {
+        const auto &sp = params.species[s];
+        footprints[sp.exclusion_level] = std::max(footprints[sp.exclusion_level], sp.footprint);
+        dependencies[sp.exclusion_level] = std::max(dependencies[sp.exclusion_level],
+                                                    poisson_dependency_cells * set.poisson_grids[s].cell_size);
+        max_cell_size = std::max(max_cell_size, set.poisson_grids[s].cell_size);
+    }
+
+    // how far past the tile each level must come out exact: as far as its footprints reach into the grids of the
+    // levels below, which their own halos extend past what they need
+    std::vector<float> exact(levels, 0.0f);
+    float grids_below = 0.0f;
+    set.poisson_reach = 0.0f;
+    for (std::size_t level = levels; level-- > 0;) {
+        if (exclude && footprints[level] > 0.0f)
+            exact[level] = footprints[level] + grids_below;
+        const float grid_reach = exact[level] + dependencies[level];
+        grids_below = std::max(grids_below, grid_reach);
+        set.poisson_reach = std::max(set.poisson_reach, grid_reach + (exclude ? footprints[level] : 0.0f));
+    }
+    // the tile's own cells already reach a cell past it
+    set.poisson_reach += max_cell_size;
+
+    for (std::size_t s = 0; s < set.poisson_grids.size(); s++) {
+        auto &grid = set.poisson_grids[s];
+        grid.halo_cells = poisson_dependency_cells +
+                static_cast<int>(std::ceil(exact[params.species[s].exclusion_level] / grid.cell_size));
+    }
+}
+
+void Entities::allocateSlots(GLsizei slots) {
+    PlacementSet &set = current_set;
+    // unused slots draw nothing until they are generated
+    std::vector<DrawElementsIndirectCommand> commands(slots * set.slot_commands.size(), {0, 0, 0, 0, 0});
+    set.command_buffer->initialize(commands, GL::Buffer::Usage::DynamicDraw);
+
+    // the culling pass starts from the ranges of every slot, with nothing visible yet
+    std::vector<DrawElementsIndirectCommand> visible_commands;
+    for (GLsizei slot = 0; slot < slots; slot++) {
+        for (auto command : set.slot_commands) {
+            command.base_instance += slot * set.slot_capacity;
+            visible_commands.push_back(command);
+        }
+    }
+    set.visible_command_reset_buffer->initialize(visible_commands, GL::Buffer::Usage::StaticCopy);
+    set.visible_command_buffer->initialize(visible_commands, GL::Buffer::Usage::DynamicCopy);
+
+    constexpr GLsizei stride = sizeof(PackedInstance);
+    set.rect_buffer->allocate(slots * static_cast<GLsizeiptr>(sizeof(InstanceRect)), GL::Buffer::Usage::DynamicDraw);
+    set.buffer->allocate(static_cast<GLsizeiptr>(slots) * set.slot_capacity * stride, GL::Buffer::Usage::StaticDraw);
+    set.visible_buffer->allocate(static_cast<GLsizeiptr>(slots) * set.slot_capacity * stride,
+                                 GL::Buffer::Usage::DynamicCopy);
+
+    GLsizeiptr max_cells = 0;
+    for (const auto &grid : set.poisson_grids) {
+        const glm::ivec2 cells = grid.cell_count + 2 * grid.halo_cells;
+        max_cells = std::max(max_cells, static_cast<GLsizeiptr>(cells.x) * cells.y);
+    }
+    if (max_cells > 0)
+        set.cell_buffer->allocate(max_cells * sizeof(glm::vec2), GL::Buffer::Usage::DynamicCopy);
+
+    // room for a few slots in flight, so that streaming one rarely waits for the GPU to be done with an earlier one
+    const GLsizeiptr slot_upload_size = static_cast<GLsizeiptr>(set.slot_capacity) * stride +
+            static_cast<GLsizeiptr>(set.slot_commands.size()) *
+                    (sizeof(DrawElementsIndirectCommand) + upload_alignment) +
+            sizeof(InstanceRect) + 2 * upload_alignment;
+    if (!upload_ring || upload_ring->size() < 4 * slot_upload_size) {
+        upload_ring.reset();
+        upload_ring.emplace(4 * slot_upload_size);
+    }
+
+    set.command_count = static_cast<GLsizei>(commands.size());
+    set.max_point_count = static_cast<GLsizei>(slots * set.slot_capacity);
+}
+
+void Entities::streamData(const GL::Buffer &target, GLintptr offset, GLsizeiptr size, const void *data) {
+    const auto region = upload_ring->allocate(size, upload_alignment);
+    std::memcpy(region.data, data, size);
+    target.copyData(upload_ring->buffer(), region.offset, offset, size);
+}
+
+void Entities::runPlacement(const PlacementRect &placement_rect, GLuint slot) {
+    PlacementSet &set = current_set;
+    set.slot_rects[slot] = placement_rect;
+    set.stale_slots.erase(slot);
+    set.unindexed_slots.insert(slot);
+
+    // the uploads below overwrite what earlier passes wrote to the slot
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+
+    auto commands = set.slot_commands;
+    for (auto &command : commands)
+        command.base_instance += slot * set.slot_capacity;
+
+    // the entities are written relative to the rectangle their candidates are drawn from
+    PlacementParameters::CellRange range {};
+    InstanceRect rect {placement_rect.pos0, placement_rect.pos1 - placement_rect.pos0};
+    if (params.mode == PlacementMode::Bayer) {
+        range = params.cellRange(placement_rect.pos0, placement_rect.pos1);
+        rect = params.cellRect(range);
+    } else {
+        // the candidates of the cells with their corner in the rectangle reach up to a cell past it
+        for (const auto &grid : set.poisson_grids)
+            rect.size = glm::max(rect.size, placement_rect.pos1 - placement_rect.pos0 + grid.cell_size);
+    }
+
+    const GLuint command_offset = slot * commands.size();
+    const GLsizeiptr commands_size = commands.size() * sizeof(DrawElementsIndirectCommand);
+    streamData(set.rect_buffer, slot * sizeof(InstanceRect), sizeof(InstanceRect), &rect);
+
+    if (exclusionActive())
+        clearOccupancy(rect);
+
+    if (cpuPlacementActive()) {
+        if (!cpu_pool)
+            cpu_pool.emplace(cpu_threads);
+        const auto result = cpu_placement->place(params, placement_rect.pos0, placement_rect.pos1, *cpu_pool);
 
-    int max_points = work_group_size.x * work_group_size.y * num_work_groups.x * num_work_groups.y;
+        // packed straight into the ring and copied to the slot's ranges on the GPU
+        // like the compute passes, whatever doesn't fit the layout's ranges is dropped
+        for (std::size_t s = 0; s < std::min(commands.size(), result.size()); s++) {
+            const std::size_t count = std::min<std::size_t>(result[s].size(), set.command_capacities[s]);
+            commands[s].instance_count = static_cast<GLuint>(count);
+            if (count == 0)
+                continue;
 
-    GLuint initial_count = 0;
-    constexpr GLsizei offset = sizeof(glm::vec4);
-    constexpr GLsizei stride = sizeof(glm::vec4);
-    GLsizei buffer_size = offset + max_points * stride;
-    buffer->allocate(buffer_size, GL::Buffer::Usage::StaticDraw);
+            const GLsizeiptr size = count * sizeof(PackedInstance);
+            const auto region = upload_ring->allocate(size, upload_alignment);
+            auto *instances = static_cast<PackedInstance *>(region.data);
+            for (std::size_t i = 0; i < count; i++)
+                instances[i] = PackedInstance::pack(result[s][i].position, rect, result[s][i].attributes);
+            set.buffer->copyData(upload_ring->buffer(), region.offset,
+                                 commands[s].base_instance * sizeof(PackedInstance), size);
+        }
+        streamData(set.command_buffer, command_offset * sizeof(DrawElementsIndirectCommand), commands_size,
+                   commands.data());
+        upload_ring->fence();
+        return;
+    }
+
+    streamData(set.command_buffer, command_offset * sizeof(DrawElementsIndirectCommand), commands_size,
+               commands.data());
+    upload_ring->fence();
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, command_binding, set.command_buffer->id());
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, species_binding, species_buffer->id());
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, point_binding, set.buffer->id());
 
-    buffer->writeData(0, sizeof(initial_count), &initial_count);
+    if (params.mode == PlacementMode::Bayer)
+        dispatchBayer(range, command_offset);
+    else
+        dispatchPoisson(placement_rect, rect, command_offset);
+
+    // only accepted points are written, and their number is left in the draw commands, which the draws and the
+    // readbacks then see
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT |
+                    GL_BUFFER_UPDATE_BARRIER_BIT);
+}
 
-    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+void Entities::dispatchBayer(const PlacementParameters::CellRange &range, GLuint command_offset) const {
+    if (range.count.x == 0 || range.count.y == 0)
+        return;
 
-    buffer->bind(GL::Buffer::Target::ShaderStorage);
-    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 0, buffer->id(), 0, buffer_size);
+    const auto id = compute_program->id();
+    glProgramUniform2ui(id, u_first_cell_loc, range.first.x, range.first.y);
+    glProgramUniform2ui(id, u_cell_count_loc, range.count.x, range.count.y);
+    glProgramUniform1f(id, u_cell_size_loc, params.candidate_spacing);
+    glProgramUniform1ui(id, u_seed_loc, params.seed);
+    glProgramUniform1f(id, u_lod_distance_loc, lodActive() ? lod_distance : 0.0f);
+    glProgramUniform3fv(id, u_camera_position_loc, 1, glm::value_ptr(lod_camera_position));
+    glProgramUniform1ui(id, u_command_offset_loc, command_offset);
 
+    // the species of the layout, which parameters edited since then can't place more of
+    const auto &capacities = current_set.command_capacities;
+    const auto species_count = static_cast<GLsizei>(std::min(params.species.size(), capacities.size()));
+    glProgramUniform1ui(id, u_species_count_loc, species_count);
+    glProgramUniform1uiv(id, u_command_capacity_loc, species_count, capacities.data());
+
+    const auto valid = validCells();
+    glProgramUniform2i(id, u_valid_first_loc, valid.first.x, valid.first.y);
+    glProgramUniform2i(id, u_valid_end_loc, valid.first.x + valid.count.x, valid.first.y + valid.count.y);
     compute_program->useProgram();
-    glDispatchCompute(num_work_groups.x, num_work_groups.y, 1);
 
-    constexpr int bind_index = 0;
-    vao->bindVertexBuffer(bind_index, buffer, offset, stride);
-    vao->attribBinding(a_position_loc, bind_index);
-    vao->attribFormat(a_position_loc, 3, GL_FLOAT, false, 0);
-    vao->enableAttrib(a_position_loc);
+    if (!exclusionActive()) {
+        // one invocation per cell of the range, every species at once
+        glProgramUniform1i(id, u_exclusion_level_loc, -1);
+        glProgramUniform1ui(id, u_margin_cells_loc, 0);
+        const glm::ivec2 groups = (range.count + placement_local_size - 1) / placement_local_size;
+        glDispatchCompute(groups.x, groups.y, 1);
+        return;
+    }
+
+    // one dispatch per priority, from the highest down, each seeing the footprints stamped by the previous ones
+    const GLuint occupancy = current_set.occupancy_texture->id();
+    glBindImageTexture(occupancy_image_unit, occupancy, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI);
+    for (std::size_t level = 0; level < exclusion_margins.size(); level++) {
+        const float margin = exclusion_margins[level];
+        const int margin_cells = margin > 0.0f ? static_cast<int>(std::ceil(margin / params.candidate_spacing)) + 1 : 0;
+        glProgramUniform1i(id, u_exclusion_level_loc, static_cast<GLint>(level));
+        glProgramUniform1ui(id, u_margin_cells_loc, margin_cells);
+
+        const glm::ivec2 groups = (range.count + 2 * margin_cells + placement_local_size - 1) / placement_local_size;
+        glDispatchCompute(groups.x, groups.y, 1);
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    }
+}
+
+void Entities::dispatchPoisson(const PlacementRect &rect, const InstanceRect &instance_rect,
+                               GLuint command_offset) const {
+    const PlacementSet &set = current_set;
+    const glm::vec2 size = rect.pos1 - rect.pos0;
+    if (size.x <= 0.0f || size.y <= 0.0f)
+        return;
+
+    const PlacementRect valid = validRect();
+    const auto id = poisson_program->id();
+    glProgramUniform2fv(id, u_poisson_rect_origin_loc, 1, glm::value_ptr(instance_rect.origin));
+    glProgramUniform2fv(id, u_poisson_rect_size_loc, 1, glm::value_ptr(instance_rect.size));
+    glProgramUniform2fv(id, u_poisson_valid_pos0_loc, 1, glm::value_ptr(valid.pos0));
+    glProgramUniform2fv(id, u_poisson_valid_pos1_loc, 1, glm::value_ptr(valid.pos1));
+    glProgramUniform1ui(id, u_poisson_trials_loc, params.poisson_trials);
+    glProgramUniform1ui(id, u_poisson_seed_loc, params.seed);
+    glProgramUniform1ui(id, u_poisson_command_offset_loc, command_offset);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, cell_binding, set.cell_buffer->id());
+    poisson_program->useProgram();
+
+    glm::ivec3 work_group_size;
+    glGetProgramiv(id, GL_COMPUTE_WORK_GROUP_SIZE, glm::value_ptr(work_group_size));
+
+    // with exclusion, the species are placed from the highest priority down, halos included
+    const bool exclude = exclusionActive();
+    glProgramUniform1i(id, u_poisson_exclusion_loc, exclude);
+    std::vector<GLuint> order(set.poisson_grids.size());
+    std::iota(order.begin(), order.end(), 0);
+    if (exclude) {
+        glBindImageTexture(occupancy_image_unit, set.occupancy_texture->id(), 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI);
+        std::stable_sort(order.begin(), order.end(), [this](GLuint a, GLuint b) {
+            return params.species[a].exclusion_level < params.species[b].exclusion_level;
+        });
+    }
+
+    for (const GLuint s : order) {
+        // the cells with their corner in the rectangle, so that adjacent tiles share none, and the halo around them
+        const auto &grid = set.poisson_grids[s];
+        const glm::ivec2 owned_first = glm::ceil(rect.pos0 / grid.cell_size);
+        const glm::ivec2 owned_end = glm::ceil(rect.pos1 / grid.cell_size);
+        const glm::ivec2 owned_count = glm::clamp(owned_end - owned_first, glm::ivec2(0), grid.cell_count);
+        if (owned_count.x == 0 || owned_count.y == 0)
+            continue;
+        const glm::ivec2 first_cell = owned_first - grid.halo_cells;
+        const glm::ivec2 cell_count = owned_count + 2 * grid.halo_cells;
+
+        glProgramUniform1ui(id, u_poisson_species_loc, s);
+        glProgramUniform1ui(id, u_poisson_command_capacity_loc, set.command_capacities[s]);
+        glProgramUniform2i(id, u_poisson_first_cell_loc, first_cell.x, first_cell.y);
+        glProgramUniform2ui(id, u_poisson_cell_count_loc, cell_count.x, cell_count.y);
+        glProgramUniform2i(id, u_poisson_owned_first_loc, owned_first.x, owned_first.y);
+        glProgramUniform2i(id, u_poisson_owned_end_loc, owned_first.x + owned_count.x, owned_first.y + owned_count.y);
+        glProgramUniform1f(id, u_poisson_cell_size_loc, grid.cell_size);
+
+        // gc_empty_cell in poisson.comp
+        const glm::vec2 empty_cell {-1e30f};
+        set.cell_buffer->clearData(GL_RG32F, GL_RG, GL_FLOAT, glm::value_ptr(empty_cell));
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+        // one invocation per cell of the phase
+        const glm::ivec2 phase_cells = (cell_count + 2) / 3;
+        const glm::ivec2 groups = (phase_cells + glm::ivec2(work_group_size) - 1) / glm::ivec2(work_group_size);
+
+        for (int phase = 0; phase < 9; phase++) {
+            // the phases of the lattice, which the grid of every tile starts at a different one of
+            const glm::ivec2 phase_offset = ((glm::ivec2(phase % 3, phase / 3) - first_cell) % 3 + 3) % 3;
+            glProgramUniform2ui(id, u_poisson_phase_loc, phase_offset.x, phase_offset.y);
+            glDispatchCompute(groups.x, groups.y, 1);
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        }
+    }
+}
+
+std::size_t Entities::updateTiles(const Camera &camera) {
+    PlacementSet &set = current_set;
+    // the placement works in texture coordinates, before the parent transform
+    const glm::vec4 camera_pos = glm::inverse(parent_transform) * glm::vec4(camera.at(), 1.0f);
+    const glm::ivec2 center_tile = glm::floor(glm::vec2(camera_pos.x, camera_pos.z) / set.tile_size);
+
+    // keep every tile around the camera ahead of the others in the LRU order before any eviction happens
+    std::vector<TileCache::Tile> missing;
+    const int radius = set.tile_radius;
+    for (int y = -radius; y <= radius; y++) {
+        for (int x = -radius; x <= radius; x++) {
+            const TileCache::Tile tile = center_tile + glm::ivec2(x, y);
+            if (set.tile_cache.find(tile) < 0)
+                missing.push_back(tile);
+        }
+    }
+
+    // closest tiles first
+    std::sort(missing.begin(), missing.end(), [center_tile](TileCache::Tile a, TileCache::Tile b) {
+        const glm::ivec2 da = a - center_tile, db = b - center_tile;
+        return da.x * da.x + da.y * da.y < db.x * db.x + db.y * db.y;
+    });
+
+    // the dispatches are queued without waiting on them; spreading them over frames keeps each one short
+    const auto count = std::min(missing.size(), static_cast<std::size_t>(tiles_per_frame));
+    for (std::size_t i = 0; i < count; i++) {
+        const auto insertion = set.tile_cache.insert(missing[i]);
+        runPlacement(tileRect(missing[i]), insertion.slot);
+    }
+    return missing.size() - count;
+}
+
+Entities::PlacementRect Entities::tileRect(TileCache::Tile tile) const {
+    // neighbouring tiles compute their shared edge the same way, so each lattice cell belongs to one tile
+    const float size = current_set.tile_size;
+    const PlacementRect rect {glm::vec2(tile) * size, glm::vec2(tile + 1) * size};
+    if (current_set.tiled)
+        return rect;
+    return {glm::clamp(rect.pos0, params.pos0, params.pos1), glm::clamp(rect.pos1, params.pos0, params.pos1)};
+}
+
+void Entities::updateFixedTiles() {
+    PlacementSet &set = current_set;
+    params.pos0 = glm::min(params.pos0, params.pos1);
+    params.pos1 = glm::max(params.pos0, params.pos1);
+
+    const glm::ivec2 first_tile = glm::floor(params.pos0 / set.tile_size);
+    const glm::ivec2 end_tile = glm::max(glm::ivec2(glm::ceil(params.pos1 / set.tile_size)), first_tile);
+    const glm::ivec2 tiles = end_tile - first_tile;
+    if (tiles.x * tiles.y > set.tile_cache.slotCount()) {
+        generateEntities();
+        return;
+    }
+
+    const auto inside = [&](TileCache::Tile tile) {
+        return glm::all(glm::greaterThanEqual(tile, first_tile)) && glm::all(glm::lessThan(tile, end_tile));
+    };
+
+    // the dropped tiles' draw commands are emptied, so their slots draw nothing until they are reused
+    std::vector<TileCache::Tile> dropped;
+    for (const auto &entry : set.tile_cache.entries()) {
+        if (!inside(entry.tile))
+            dropped.push_back(entry.tile);
+    }
+    // rectangles whose entities change, which the footprints of the tiles around them may reach
+    std::vector<PlacementRect> changed;
+    std::vector<bool> placed(set.tile_cache.slotCount(), false);
+
+    const std::vector<DrawElementsIndirectCommand> empty(set.slot_commands.size(), {0, 0, 0, 0, 0});
+    for (const auto tile : dropped) {
+        const auto slot = static_cast<GLuint>(set.tile_cache.erase(tile));
+        changed.push_back(set.slot_rects[slot]);
+        set.stale_slots.erase(slot);
+        set.unindexed_slots.insert(slot);
+        streamData(set.command_buffer, slot * empty.size() * sizeof(DrawElementsIndirectCommand),
+                   empty.size() * sizeof(DrawElementsIndirectCommand), empty.data());
+    }
+    upload_ring->fence();
+
+    for (int y = first_tile.y; y < end_tile.y; y++) {
+        for (int x = first_tile.x; x < end_tile.x; x++) {
+            const TileCache::Tile tile {x, y};
+            const PlacementRect rect = tileRect(tile);
+
+            int slot = set.tile_cache.find(tile);
+            if (slot < 0)
+                slot = set.tile_cache.insert(tile).slot;
+            else if (set.slot_rects[slot] == rect)
+                continue;
+            else
+                changed.push_back(set.slot_rects[slot]);
+
+            changed.push_back(rect);
+            runPlacement(rect, slot);
+            placed[slot] = true;
+        }
+    }
+
+    // the Poisson cells depend on the cells around them, and so on the edges of the rectangle, even without exclusion
+    if (params.mode == PlacementMode::Bayer && !exclusionActive())
+        return;
+
+    const float margin = placementReach();
+    for (const auto &entry : set.tile_cache.entries()) {
+        const PlacementRect &slot_rect = set.slot_rects[entry.slot];
+        const bool reached = std::any_of(changed.begin(), changed.end(), [&](const PlacementRect &rect) {
+            return overlaps(slot_rect, rect, margin);
+        });
+        if (!placed[entry.slot] && reached)
+            runPlacement(slot_rect, entry.slot);
+    }
+}
+
+std::size_t Entities::placeFixedTiles(std::size_t budget) {
+    PlacementSet &set = current_set;
+    const glm::ivec2 first_tile = glm::floor(params.pos0 / set.tile_size);
+    const glm::ivec2 end_tile = glm::max(glm::ivec2(glm::ceil(params.pos1 / set.tile_size)), first_tile);
+
+    // each tile's placement already accounts for its neighbours, so they can be placed in any order
+    std::size_t left = 0;
+    for (int y = first_tile.y; y < end_tile.y; y++) {
+        for (int x = first_tile.x; x < end_tile.x; x++) {
+            const TileCache::Tile tile {x, y};
+            if (set.tile_cache.find(tile) >= 0)
+                continue;
+            if (budget == 0) {
+                left++;
+                continue;
+            }
+            budget--;
+            runPlacement(tileRect(tile), set.tile_cache.insert(tile).slot);
+        }
+    }
+    return left;
+}
+
+void Entities::regenerateDirtyTiles() {
+    PlacementSet &set = current_set;
+    if (set.dirty_rects.empty())
+        return;
+
+    const float margin = placementReach();
+    for (const auto &entry : set.tile_cache.entries()) {
+        const PlacementRect &slot_rect = set.slot_rects[entry.slot];
+        const bool dirty = std::any_of(set.dirty_rects.begin(), set.dirty_rects.end(), [&](const PlacementRect &rect) {
+            return overlaps(slot_rect, rect, margin);
+        });
+        if (dirty)
+            runPlacement(slot_rect, entry.slot);
+    }
+    set.dirty_rects.clear();
+}
+
+void Entities::regenerateStaleTiles(std::size_t budget) {
+    PlacementSet &set = current_set;
+    // runPlacement() takes each slot off the queue
+    for (; budget > 0 && !set.stale_slots.empty(); budget--) {
+        const GLuint slot = *set.stale_slots.begin();
+        runPlacement(set.slot_rects[slot], slot);
+    }
+}
+
+void Entities::cullEntities() {
+    PlacementSet &set = current_set;
+    const GLsizeiptr commands_size = static_cast<GLsizeiptr>(set.command_count) * sizeof(DrawElementsIndirectCommand);
+    set.visible_command_buffer->copyData(set.visible_command_reset_buffer, 0, 0, commands_size);
+
+    const glm::mat4 model_view = view_matrix * parent_transform;
+    const auto id = cull_program->id();
+    glProgramUniformMatrix4fv(id, u_cull_model_view_loc, 1, false, glm::value_ptr(model_view));
+    glProgramUniformMatrix4fv(id, u_cull_proj_loc, 1, false, glm::value_ptr(proj_matrix));
+    glProgramUniform1ui(id, u_cull_species_count_loc, static_cast<GLuint>(params.species.size()));
+
+    const bool test_occlusion = occlusionCulling() && depth_pyramid->levels() > 0;
+    glProgramUniform1i(id, u_cull_occlusion_loc, test_occlusion);
+    if (test_occlusion) {
+        const glm::vec2 viewport_size = depth_pyramid->size();
+        glBindTextureUnit(depth_pyramid_tex_unit, depth_pyramid->texture().id());
+        glProgramUniform1i(id, u_cull_depth_pyramid_loc, depth_pyramid_tex_unit);
+        glProgramUniform1i(id, u_cull_pyramid_levels_loc, depth_pyramid->levels());
+        glProgramUniform2f(id, u_cull_viewport_size_loc, viewport_size.x, viewport_size.y);
+    }
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, cull_command_binding, set.command_buffer->id());
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, cull_point_binding, set.buffer->id());
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, cull_visible_command_binding, set.visible_command_buffer->id());
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, cull_visible_point_binding, set.visible_buffer->id());
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, cull_species_binding, species_buffer->id());
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, instance_rect_binding, set.rect_buffer->id());
+
+    glm::ivec3 work_group_size;
+    glGetProgramiv(id, GL_COMPUTE_WORK_GROUP_SIZE, glm::value_ptr(work_group_size));
 
-    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    // one work group row per draw command, long enough for the largest range
+    cull_program->useProgram();
+    glDispatchCompute((set.command_capacity + work_group_size.x - 1) / work_group_size.x, set.command_count, 1);
 
-    //auto data = glMapNamedBuffer(buffer->id(), GL_READ_ONLY);
-    //glUnmapNamedBuffer(buffer->id());
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    if (culling_stats) {
+        std::vector<DrawElementsIndirectCommand> placed(set.command_count), visible(set.command_count);
+        set.command_buffer->readData(0, commands_size, placed.data());
+        set.visible_command_buffer->readData(0, commands_size, visible.data());
+
+        placed_count = 0;
+        visible_count = 0;
+        for (GLsizei i = 0; i < set.command_count; i++) {
+            placed_count += placed[i].instance_count;
+            visible_count += visible[i].instance_count;
+        }
+    }
+}
+
+void Entities::regeneratePlacement() {
+    for (const auto &entry : current_set.tile_cache.entries())
+        runPlacement(current_set.slot_rects[entry.slot], entry.slot);
+
+    // a placement still being generated used the previous parameters
+    if (pending_generation)
+        generateEntitiesInBackground();
+}
+
+bool Entities::lodActive() const {
+    return lod && params.mode == PlacementMode::Bayer;
+}
+
+bool Entities::cpuPlacementActive() const {
+    return cpu_streaming && cpu_placement && params.mode == PlacementMode::Bayer && !lodActive() && !exclusionActive();
+}
+
+bool Entities::exclusionActive() const {
+    return exclusion && exclusion_margins.size() > 1 && exclusion_reach > 0.0f;
+}
+
+Entities::PlacementRect Entities::validRect() const {
+    if (current_set.tiled)
+        return {glm::vec2(0.0f), glm::vec2(1.0f)};
+    return {params.pos0, params.pos1};
+}
+
+PlacementParameters::CellRange Entities::validCells() const {
+    const PlacementRect valid = validRect();
+    return params.cellRange(valid.pos0, valid.pos1);
+}
+
+void Entities::clearOccupancy(const InstanceRect &rect) const {
+    // every texel this placement reads or stamps, so that footprints left by other parameters don't leak into it
+    const float margin = placementReach();
+    const glm::ivec2 texel_min = glm::max(glm::ivec2(glm::floor((rect.origin - margin) * float(occupancy_size))), 0);
+    const glm::vec2 rect_end = rect.origin + rect.size + margin;
+    const glm::ivec2 texel_max = glm::min(glm::ivec2(glm::ceil(rect_end * float(occupancy_size))), occupancy_size);
+    if (glm::any(glm::lessThanEqual(texel_max, texel_min)))
+        return;
+
+    constexpr GLuint empty = 0;
+    const glm::ivec2 texels = texel_max - texel_min;
+    current_set.occupancy_texture->clearSubImage2D(0, texel_min.x, texel_min.y, texels.x, texels.y,
+                                                   GL::Texture::Format::RedInt, GL::Texture::Type::UInt, &empty);
+}
+
+float Entities::placementReach() const {
+    if (params.mode == PlacementMode::PoissonDisk)
+        return current_set.poisson_reach;
+    // a candidate may be jittered up to a cell past its tile's rectangle, and the footprints of the entities that
+    // change may change the entities around them
+    return params.candidate_spacing + (exclusionActive() ? exclusion_reach : 0.0f);
+}
+
+bool Entities::overlaps(const PlacementRect &a, const PlacementRect &b, float margin) {
+    return glm::all(glm::lessThan(a.pos0, b.pos1 + margin)) && glm::all(glm::lessThan(b.pos0 - margin, a.pos1));
+}
+
+GLuint64 Entities::candidateCount() const {
+    if (params.mode == PlacementMode::Bayer) {
+        const auto range = params.cellRange(params.pos0, params.pos1);
+        return static_cast<GLuint64>(range.count.x) * range.count.y;
+    }
+
+    // every tile evaluates its whole grid, halo included
+    GLuint64 candidates = 0;
+    for (const auto &grid : current_set.poisson_grids) {
+        const glm::ivec2 cells = grid.cell_count + 2 * grid.halo_cells;
+        candidates += static_cast<GLuint64>(cells.x) * cells.y * params.poisson_trials;
+    }
+    return candidates * current_set.tile_cache.size();
+}
+
+void Entities::benchmark() {
+    const auto original_mode = params.mode;
+    const auto original_tiled = tiled;
+    const auto original_cpu_streaming = cpu_streaming;
+    tiled = false;
+    cpu_streaming = false;
+    benchmark_results.clear();
+
+    for (auto mode : {PlacementMode::Bayer, PlacementMode::PoissonDisk}) {
+        params.mode = mode;
+
+        // allocates the buffers and warms up the pipeline
+        generateEntities();
+
+        timer_query->begin();
+        for (int i = 0; i < benchmark_runs; i++)
+            regeneratePlacement();
+        timer_query->end();
+
+        const double milliseconds = static_cast<double>(timer_query->result()) * 1e-6 / benchmark_runs;
+
+        std::vector<DrawElementsIndirectCommand> results(current_set.command_count);
+        current_set.command_buffer->readData(0, results.size() * sizeof(DrawElementsIndirectCommand), results.data());
+
+        GLuint64 placed = 0;
+        for (const auto &command : results)
+            placed += command.instance_count;
+
+        benchmark_results.push_back({mode, milliseconds, candidateCount(), placed});
+    }
+
+    params.mode = original_mode;
+    tiled = original_tiled;
+    cpu_streaming = original_cpu_streaming;
+    generateEntities();
+}
+
+void Entities::autotune() {
+    const auto original_mode = params.mode;
+    const auto original_tiled = tiled;
+    const auto original_cpu_streaming = cpu_streaming;
+    params.mode = PlacementMode::Bayer;
+    tiled = false;
+    cpu_streaming = false;
+
+    // every variant places the same entities into the same layout
+    generateEntities();
+    autotune_results = work_group_tuner.tune("placement.comp",
+                                             [this](glm::ivec2 local_size) { loadPlacementProgram(local_size); },
+                                             [this] { regeneratePlacement(); }, benchmark_runs);
+    loadPlacementProgram(work_group_tuner.find("placement.comp", placement_local_size));
+
+    params.mode = original_mode;
+    tiled = original_tiled;
+    cpu_streaming = original_cpu_streaming;
+    generateEntities();
+}
+
+void Entities::benchmarkSpatialIndex() {
+    constexpr int tiles_per_side = 10;
+    constexpr std::size_t entities_per_tile = 100'000;
+    constexpr std::size_t query_count = 100'000;
+
+    // uniformly spread over the map in 100 tiles of 100k entities, like a dense placement
+    std::vector<std::vector<glm::vec3>> tile_positions(tiles_per_side * tiles_per_side);
+    std::vector<std::uint32_t> species(entities_per_tile);
+    std::uint32_t state = 1;
+    const auto next_float = [&state] {
+        state = state * 747796405u + 2891336453u;
+        return static_cast<float>(state >> 8) / 16777216.0f;
+    };
+    for (std::size_t tile = 0; tile < tile_positions.size(); tile++) {
+        const int index = static_cast<int>(tile);
+        const glm::vec2 origin = glm::vec2(index % tiles_per_side, index / tiles_per_side) / float(tiles_per_side);
+        for (std::size_t i = 0; i < entities_per_tile; i++) {
+            const glm::vec2 xz = origin + glm::vec2(next_float(), next_float()) / float(tiles_per_side);
+            tile_positions[tile].emplace_back(xz.x, next_float(), xz.y);
+        }
+    }
+    for (std::size_t i = 0; i < species.size(); i++)
+        species[i] = static_cast<std::uint32_t>(i % 4);
+
+    std::vector<glm::vec2> centers(query_count), box_max(query_count);
+    for (std::size_t i = 0; i < query_count; i++)
+        centers[i] = {next_float(), next_float()};
+    // about 30 entities within the radius, and 40 in the boxes
+    const float radius = 0.001f;
+    for (std::size_t i = 0; i < query_count; i++)
+        box_max[i] = centers[i] + 0.002f;
+
+    if (!cpu_pool)
+        cpu_pool.emplace(cpu_threads);
+
+    using Clock = std::chrono::steady_clock;
+    const auto elapsed = [](Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    };
+
+    SpatialIndex index;
+    auto start = Clock::now();
+    for (std::size_t tile = 0; tile < tile_positions.size(); tile++)
+        index.setTile(static_cast<int>(tile), tile_positions[tile], species);
+    SpatialIndexBenchmark result {index.size(), query_count, elapsed(start), 0.0, 0.0, 0.0, 0.0};
+
+    SpatialIndex::Results results;
+    start = Clock::now();
+    index.radius(centers, radius, results, *cpu_pool);
+    result.radius_milliseconds = elapsed(start);
+    result.hits_per_radius_query = static_cast<double>(results.hits.size()) / query_count;
+
+    start = Clock::now();
+    index.box(centers, box_max, results, *cpu_pool);
+    result.box_milliseconds = elapsed(start);
+
+    start = Clock::now();
+    index.nearest(centers, 8, results, *cpu_pool);
+    result.nearest_milliseconds = elapsed(start);
+
+    spatial_index_benchmark = result;
+}
+
+void Entities::validateCpuPlacement() {
+    PlacementSet &set = current_set;
+    // the placement compared has to come from the compute passes
+    const auto original_cpu_streaming = cpu_streaming;
+    cpu_streaming = false;
+    generateEntities();
+
+    std::vector<DrawElementsIndirectCommand> commands(set.command_count);
+    set.command_buffer->readData(0, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data());
+    std::vector<InstanceRect> rects(set.tile_cache.slotCount());
+    set.rect_buffer->readData(0, rects.size() * sizeof(InstanceRect), rects.data());
+
+    if (!cpu_pool)
+        cpu_pool.emplace(cpu_threads);
+
+    const auto start = std::chrono::steady_clock::now();
+    const auto cpu_result = cpu_placement->place(params, params.pos0, params.pos1, *cpu_pool);
+    const std::chrono::duration<double, std::milli> cpu_time = std::chrono::steady_clock::now() - start;
+
+    // the GPU writes each work group's entities in whatever order the work groups run, so compare them sorted
+    const auto z_order = [](const CpuPlacement::Entity &a, const CpuPlacement::Entity &b) {
+        return a.position.z < b.position.z;
+    };
+    // the GPU positions are quantized to 16 bits of their tile's rectangle, and may have been contracted into fused
+    // multiply-adds before that, which can round them to the next step
+    float position_epsilon = 0.0f;
+    for (const auto &entry : set.tile_cache.entries()) {
+        const glm::vec2 size = rects[entry.slot].size;
+        position_epsilon = std::max(position_epsilon, std::max(size.x, size.y) / 65535.0f);
+    }
+
+    validation_results.clear();
+    for (std::size_t s = 0; s < set.slot_commands.size(); s++) {
+        // the entities of every tile of the rectangle
+        std::vector<CpuPlacement::Entity> gpu;
+        for (const auto &entry : set.tile_cache.entries()) {
+            const auto &command = commands[entry.slot * set.slot_commands.size() + s];
+            std::vector<PackedInstance> instances(command.instance_count);
+            set.buffer->readData(static_cast<GLintptr>(command.base_instance) * sizeof(PackedInstance),
+                                 static_cast<GLsizeiptr>(instances.size()) * sizeof(PackedInstance), instances.data());
+            for (const auto &instance : instances)
+                gpu.push_back({instance.position(rects[entry.slot]), instance.attributes()});
+        }
+
+        std::vector<CpuPlacement::Entity> cpu = cpu_result[s];
+        std::sort(cpu.begin(), cpu.end(), z_order);
+
+        ValidationResult result {static_cast<GLuint>(gpu.size()), static_cast<GLuint>(cpu.size()), 0, 0, 0, 0.0f,
+                                 cpu_time.count()};
+
+        // each CPU entity pairs with a single GPU entity, so duplicates or extra entities on either side show up
+        std::vector<bool> matched(cpu.size(), false);
+        for (const auto &entity : gpu) {
+            const glm::vec3 point = entity.position;
+            const CpuPlacement::Entity lowest {{point.x, point.y, point.z - position_epsilon}, 0};
+            auto it = std::lower_bound(cpu.begin(), cpu.end(), lowest, z_order);
+            while (it != cpu.end() && it->position.z <= point.z + position_epsilon &&
+                   (matched[it - cpu.begin()] || std::abs(it->position.x - point.x) > position_epsilon))
+                ++it;
+
+            if (it == cpu.end() || it->position.z > point.z + position_epsilon) {
+                result.unmatched_gpu++;
+                continue;
+            }
+            matched[it - cpu.begin()] = true;
+            // the yaw, scale and variant are hashed from the same cell on both sides, so they match exactly
+            if (it->attributes != entity.attributes)
+                result.attribute_mismatches++;
+            result.max_height_error = std::max(result.max_height_error, std::abs(it->position.y - point.y));
+        }
+        result.unmatched_cpu = static_cast<GLuint>(std::count(matched.begin(), matched.end(), false));
+        validation_results.push_back(result);
+    }
 
-    //glNamedBufferSubData(buffer->id(), 0, sizeof(initial_count), &point_count);
-    point_count = max_points;
+    cpu_streaming = original_cpu_streaming;
+    if (cpu_streaming)
+        regeneratePlacement();
 }
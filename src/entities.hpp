@@ -4,51 +4,481 @@
 #include "gl_utils/gl.hpp"
 
 #include "utils/shader_load.hpp"
+#include "utils/camera.hpp"
+
+#include "tile_cache.hpp"
+#include "placement_parameters.hpp"
+#include "cpu_placement.hpp"
+#include "thread_pool.hpp"
+#include "depth_pyramid.hpp"
+#include "work_group_tuner.hpp"
+#include "spatial_index.hpp"
 
 #include <glm/vec2.hpp>
+#include <glm/vec4.hpp>
 #include <glm/mat4x4.hpp>
 
+#include <optional>
+#include <set>
+#include <vector>
+
 class Entities {
 public:
     Entities();
 
-    void update();
+    void update(const Camera& camera);
+
+    void setParentTransform(const glm::mat4& matrix);
+
+    void setViewMatrix(const glm::mat4& matrix);
+
+    void setProjMatrix(const glm::mat4& matrix);
 
-    void setParentTransform(const glm::mat4& matrix) const;
+    void setWorldDataTexUnit(GLint unit);
 
-    void setViewMatrix(const glm::mat4& matrix) const;
+    /**
+     * @brief Sample the altitude, slope and curvature rules of the species from Terrain::derivativeTexture(), bound to
+     * @p unit. The CPU placement gets a copy of it, so setWorldData() has to be called first.
+     */
+    void setTerrainDerivatives(GL::Texture texture, GLint unit);
 
-    void setProjMatrix(const glm::mat4& matrix) const;
+    /// Occluders for the culling pass, or nullptr to only cull against the frustum. Must outlive this object.
+    void setDepthPyramid(const DepthPyramid* pyramid);
 
-    void setWorldDataTexUnit(GLint unit) const;
+    /// Whether the culling pass reads the depth pyramid, which has to be built before update().
+    [[nodiscard]] bool occlusionCulling() const;
 
+    /// Keep a CPU copy of the world data bound to the world data texture unit, used to validate the GPU placement.
+    void setWorldData(const Image& world_data);
+
+    /// Lay out the buffers for the current parameters; in fixed mode also place the entities of the pos0 - pos1 rectangle.
     void generateEntities();
 
+    /**
+     * @brief Like generateEntities(), without reallocating the buffers being drawn.
+     *
+     * The new placement is generated into a second set of buffers, tiles_per_frame tiles per update(), and replaces the
+     * current one at the first update() after the GPU has finished its last tile. Until then the previous entities are
+     * drawn and updated as before.
+     */
+    void generateEntitiesInBackground();
+
+    /**
+     * @brief Regenerate the entities of the cached tiles overlapping a rectangle at the next update(), e.g. after the
+     * world data there was edited.
+     *
+     * Only those tiles are placed again, into the slots they already hold; the other tiles' entities are untouched.
+     */
+    void markDirty(glm::vec2 pos0, glm::vec2 pos1);
+
+    /// Time every placement mode with the current parameters and keep the results for display.
+    void benchmark();
+
+    /// Time the work group sizes of the Bayer placement pass and keep the fastest, which later runs start with.
+    void autotune();
+
+    /// Compare the GPU placement of the pos0 - pos1 rectangle against CpuPlacement, species by species.
+    void validateCpuPlacement();
+
+    /// Entities drawn as of the last update() with the spatial index enabled, one tile per slot.
+    [[nodiscard]] const SpatialIndex& spatialIndex() const;
+
+    /// Time building a SpatialIndex of 10M random entities and batches of queries on it.
+    void benchmarkSpatialIndex();
+
 private:
 
-    GL::ObjectManager<GL::ShaderProgram> shader_program {loadProgram("shaders/point.vert", "shaders/point.frag")};
-    GL::ObjectManager<GL::ShaderProgram> compute_program {loadComputeProgram("shaders/placement.comp")};
-    GL::ObjectManager<GL::Buffer> buffer {};
+    /// Layout of the parameters read by glDrawElementsIndirect. The placement passes count the entities of a command
+    /// in instance_count and write them from base_instance on.
+    struct DrawElementsIndirectCommand {
+        GLuint count;
+        GLuint instance_count;
+        GLuint first_index;
+        GLint base_vertex;
+        GLuint base_instance;
+    };
+
+    /// Rectangle of texture coordinates [pos0, pos1) that a slot is placed for.
+    struct PlacementRect {
+        glm::vec2 pos0;
+        glm::vec2 pos1;
+
+        bool operator==(const PlacementRect &other) const = default;
+    };
+
+    /// Range of one EntityMesh in the mesh atlas buffers.
+    struct MeshRange {
+        GLuint index_count;
+        GLuint first_index;
+        GLint base_vertex;
+        /// Distance from the origin to the farthest vertex, before mesh_scale.
+        float radius;
+    };
+
+    /// Cell lattice used by the Poisson disk mode for one species, anchored at the origin of the map.
+    struct PoissonGrid {
+        /// Most cells with their corner in a tile.
+        glm::ivec2 cell_count;
+        float cell_size;
+        /// Cells placed around a tile's own so that these come out the same as in any other tile, see poisson.comp.
+        int halo_cells;
+    };
+
+    struct BenchmarkResult {
+        PlacementMode mode;
+        double milliseconds;
+        GLuint64 candidates;
+        GLuint64 placed;
+    };
+
+    struct SpatialIndexBenchmark {
+        std::size_t entities;
+        std::size_t queries;
+        double build_milliseconds;
+        double radius_milliseconds;
+        double box_milliseconds;
+        double nearest_milliseconds;
+        double hits_per_radius_query;
+    };
+
+    struct ValidationResult {
+        GLuint gpu_count;
+        GLuint cpu_count;
+        /// Entities of each side left once every GPU entity has been paired with a distinct CPU entity at the same
+        /// texture coordinates, to within a quantization step.
+        GLuint unmatched_gpu;
+        GLuint unmatched_cpu;
+        /// Matched pairs whose yaw, scale or variant differ.
+        GLuint attribute_mismatches;
+        float max_height_error;
+        double cpu_milliseconds;
+
+        /// Whether both sides placed the same entities, with heights at most one unorm16 step apart.
+        [[nodiscard]] bool matches() const {
+            return gpu_count == cpu_count && unmatched_gpu == 0 && unmatched_cpu == 0 && attribute_mismatches == 0 &&
+                   max_height_error <= 1.0f / 65535.0f;
+        }
+    };
+
+    /**
+     * @brief Output and layout of a whole placement.
+     *
+     * Everything generateEntities() reallocates or resets, the scratch memory the placement passes write and the tile
+     * layout it was generated with, so that one set can be generated while the other is drawn and streamed.
+     */
+    struct PlacementSet {
+        GL::ObjectManager<GL::Buffer> command_buffer {};
+        /// Placed entities of every slot, as PackedInstance.
+        GL::ObjectManager<GL::Buffer> buffer {};
+        /// InstanceRect of each slot, which the positions of its entities are relative to.
+        GL::ObjectManager<GL::Buffer> rect_buffer {};
+        GL::ObjectManager<GL::Buffer> cell_buffer {};
+        /// Culling output: the visible entities, in the same ranges as in buffer, and their draw commands.
+        GL::ObjectManager<GL::Buffer> visible_buffer {};
+        GL::ObjectManager<GL::Buffer> visible_command_buffer {};
+        /// Draw commands with a zero count copied to visible_command_buffer before each culling pass.
+        GL::ObjectManager<GL::Buffer> visible_command_reset_buffer {};
+        /// Highest priority footprint covering each texel, as gc_max_species - exclusion_level (0 when free).
+        GL::ObjectManager<GL::Texture> occupancy_texture {GL::Texture::Target::Tex2D};
+
+        /// Tile layout of the slots, copied from the members of the same names by layoutPlacement().
+        bool tiled {false};
+        float tile_size {0.05f};
+        int tile_radius {2};
+        TileCache tile_cache;
+        /// Rectangle each slot was last placed for.
+        std::vector<PlacementRect> slot_rects;
+        std::vector<PlacementRect> dirty_rects;
+
+        /// Draw commands of the first slot; the ones of other slots are offset by slot_capacity.
+        std::vector<DrawElementsIndirectCommand> slot_commands;
+        /// Size of the range of each draw command, which the placement never writes past whatever the parameters.
+        std::vector<GLuint> command_capacities;
+        std::vector<PoissonGrid> poisson_grids;
+        /// Farthest past a tile that its Poisson grids, or the footprints they stamp, reach.
+        float poisson_reach {0.0f};
+        GLuint slot_capacity {0};
+        /// Largest output range of a single draw command.
+        GLuint command_capacity {0};
+        GLsizei command_count {0};
+        GLsizei max_point_count {0};
+
+        SpatialIndex spatial_index;
+        /// Slots placed or emptied since spatial_index last read them back.
+        std::set<GLuint> unindexed_slots;
+        /// Slots placed for an earlier LOD camera position, placed again a few per frame.
+        std::set<GLuint> stale_slots;
+        /// Slots issued before readback_fence, read back into spatial_index once it signals.
+        std::set<GLuint> readback_slots;
+        std::optional<GL::ObjectManager<GL::Fence>> readback_fence;
+    };
+
+    /// Fill the mesh atlas with every EntityMesh and record their ranges.
+    void uploadMeshes();
+
+    /// Compile placement.comp with work groups of @p local_size and the current dither size, and query its uniforms.
+    void loadPlacementProgram(glm::ivec2 local_size);
+
+    /// Derive the bounding radius of each species and upload them.
+    void uploadSpecies();
+
+    /// Lay out the output range of each species for a placement rectangle of the given size.
+    void layoutCommands(glm::vec2 size);
+
+    /// Size the halos of poisson_grids, and poisson_reach, for the current exclusion levels.
+    void layoutPoissonHalos();
+
+    /// Allocate the draw commands and the output ranges of @p slots placement rectangles.
+    void allocateSlots(GLsizei slots);
+
+    /// Run the placement compute passes for @p rect into the output ranges of @p slot, replacing its entities.
+    void runPlacement(const PlacementRect& rect, GLuint slot);
+
+    void dispatchBayer(const PlacementParameters::CellRange& range, GLuint command_offset) const;
+
+    /// Place the lattice cells with their corner in @p rect, writing the entities relative to @p instance_rect.
+    void dispatchPoisson(const PlacementRect& rect, const InstanceRect& instance_rect, GLuint command_offset) const;
+
+    /// Part of @p tile that is placed: the whole tile around the camera, its intersection with pos0 - pos1 otherwise.
+    [[nodiscard]] PlacementRect tileRect(TileCache::Tile tile) const;
+
+    /// Generate the tiles around the camera that aren't cached yet, within the per-frame budget; returns how many of
+    /// them are left for the next frames.
+    std::size_t updateTiles(const Camera& camera);
+
+    /**
+     * @brief Bring the tiles of the fixed rectangle up to date after pos0 or pos1 changed.
+     *
+     * Tiles whose part of the rectangle is the same keep their entities, the others are placed again in place and the
+     * tiles left outside are dropped. Falls back to generateEntities() when the tiles don't fit in the slots.
+     */
+    void updateFixedTiles();
+
+    /// Place up to @p budget of the pos0 - pos1 tiles that aren't cached yet; returns how many of them are left.
+    std::size_t placeFixedTiles(std::size_t budget);
+
+    /// The part of generateEntities() that sizes and resets the layout, without placing anything.
+    void layoutPlacement();
+
+    /// Place again the cached tiles overlapping the rectangles passed to markDirty().
+    void regenerateDirtyTiles();
+
+    /// Place again up to @p budget of the slots placed for an earlier LOD camera position.
+    void regenerateStaleTiles(std::size_t budget);
+
+    /// Copy the entities inside the view frustum to the visible buffer, and their counts to the visible draw commands.
+    void cullEntities();
+
+    /// Place every cached tile again, keeping the current layout.
+    void regeneratePlacement();
+
+    /// Exchange current_set with pending_set.
+    void swapPlacementSet();
+
+    /// Read back the slots placed before the last call into spatial_index, once the GPU is done placing them.
+    void updateSpatialIndex();
+
+    [[nodiscard]] bool lodActive() const;
+
+    /// Whether runPlacement() places on the CPU; CpuPlacement only implements the Bayer mode without LOD.
+    [[nodiscard]] bool cpuPlacementActive() const;
+
+    /// Whether the species of lower priority are kept out of the footprints of the higher ones; it takes at least two
+    /// priorities and a footprint.
+    [[nodiscard]] bool exclusionActive() const;
+
+    /// Where entities may be placed: the pos0 - pos1 rectangle, or the whole terrain when tiled.
+    [[nodiscard]] PlacementRect validRect() const;
+
+    /// Cells of validRect(). Footprints are only stamped from these, so that a tile sees the same neighbours as the
+    /// rectangle placed at once.
+    [[nodiscard]] PlacementParameters::CellRange validCells() const;
+
+    /// How far past a tile's rectangle a change can alter the entities placed for the tile.
+    [[nodiscard]] float placementReach() const;
+
+    /// Clear the occupancy texels that a placement of @p rect reads or stamps.
+    void clearOccupancy(const InstanceRect &rect) const;
+
+    /// Whether @p a and @p b, one of them grown by @p margin on every side, overlap.
+    [[nodiscard]] static bool overlaps(const PlacementRect &a, const PlacementRect &b, float margin);
+
+    /// Copy @p size bytes of @p data to @p target at @p offset through upload_ring. The caller fences the ring once
+    /// the copies are queued.
+    void streamData(const GL::Buffer& target, GLintptr offset, GLsizeiptr size, const void* data);
+
+    /// Number of candidates evaluated by a run of the current mode.
+    [[nodiscard]] GLuint64 candidateCount() const;
+
+    GL::ObjectManager<GL::ShaderProgram> shader_program {loadProgram("shaders/entity.vert", "shaders/entity.frag")};
+    /// Variant of placement.comp with work groups of placement_local_size, see loadPlacementProgram().
+    GL::ObjectManager<GL::ShaderProgram> compute_program {};
+    GL::ObjectManager<GL::ShaderProgram> poisson_program {loadComputeProgram("shaders/poisson.comp")};
+    GL::ObjectManager<GL::ShaderProgram> cull_program {loadComputeProgram("shaders/cull.comp")};
+    GL::ObjectManager<GL::Buffer> species_buffer {};
+    /// Vertices and indices of every EntityMesh, drawn with the ranges in meshes.
+    GL::ObjectManager<GL::Buffer> mesh_vertex_buffer {};
+    GL::ObjectManager<GL::Buffer> mesh_element_buffer {};
+    /// Staging memory of everything runPlacement() uploads, so that it never reallocates nor waits on a buffer in use.
+    std::optional<GL::RingBuffer> upload_ring;
     GL::ObjectManager<GL::VertexArray> vao {};
+    GL::ObjectManager<GL::Query> timer_query {GL::Query::Target::TimeElapsed};
 
-    GLint a_position_loc = shader_program->getAttribLocation("a_position");
+    GLint a_position_loc = shader_program->getAttribLocation("a_position"),
+        a_normal_loc = shader_program->getAttribLocation("a_normal"),
+        a_instance_loc = shader_program->getAttribLocation("a_instance");
     GLint u_model_loc = shader_program->getUniformLocation("u_model"),
         u_view_loc = shader_program->getUniformLocation("u_view"),
         u_proj_loc = shader_program->getUniformLocation("u_proj"),
-        u_point_size_loc = shader_program->getUniformLocation("u_point_size"),
-        u_color_loc = shader_program->getUniformLocation("u_color");
-    GLint u_world_data_loc = compute_program->getUniformLocation("u_world_data"),
-        u_tex_coord_offset_loc = compute_program->getUniformLocation("u_tex_coord_offset"),
-        u_tex_coord_scale_loc = compute_program->getUniformLocation("u_tex_coord_scale");
-
-    glm::vec2 pos0 {.3f, .25f};
-    glm::vec2 pos1 {.5f, .6f};
-    glm::ivec2 num_work_groups {8, 8};
-
-    GLsizei point_count {0};
-    glm::vec4 point_color;
-    float point_size;
+        u_draw_species_count_loc = shader_program->getUniformLocation("u_species_count");
+    /// Uniforms of placement.comp, queried by loadPlacementProgram().
+    GLint u_world_data_loc {-1},
+        u_terrain_derivatives_loc {-1},
+        u_first_cell_loc {-1},
+        u_cell_count_loc {-1},
+        u_cell_size_loc {-1},
+        u_seed_loc {-1},
+        u_lod_distance_loc {-1},
+        u_camera_position_loc {-1},
+        u_compute_model_loc {-1},
+        u_species_count_loc {-1},
+        u_command_offset_loc {-1},
+        u_command_capacity_loc {-1},
+        u_exclusion_level_loc {-1},
+        u_margin_cells_loc {-1},
+        u_valid_first_loc {-1},
+        u_valid_end_loc {-1};
+    GLint u_poisson_world_data_loc = poisson_program->getUniformLocation("u_world_data"),
+        u_poisson_terrain_derivatives_loc = poisson_program->getUniformLocation("u_terrain_derivatives"),
+        u_poisson_first_cell_loc = poisson_program->getUniformLocation("u_first_cell"),
+        u_poisson_owned_first_loc = poisson_program->getUniformLocation("u_owned_first"),
+        u_poisson_owned_end_loc = poisson_program->getUniformLocation("u_owned_end"),
+        u_poisson_rect_origin_loc = poisson_program->getUniformLocation("u_rect_origin"),
+        u_poisson_rect_size_loc = poisson_program->getUniformLocation("u_rect_size"),
+        u_poisson_valid_pos0_loc = poisson_program->getUniformLocation("u_valid_pos0"),
+        u_poisson_valid_pos1_loc = poisson_program->getUniformLocation("u_valid_pos1"),
+        u_poisson_species_loc = poisson_program->getUniformLocation("u_species"),
+        u_poisson_phase_loc = poisson_program->getUniformLocation("u_phase"),
+        u_poisson_cell_count_loc = poisson_program->getUniformLocation("u_cell_count"),
+        u_poisson_cell_size_loc = poisson_program->getUniformLocation("u_cell_size"),
+        u_poisson_trials_loc = poisson_program->getUniformLocation("u_trials"),
+        u_poisson_seed_loc = poisson_program->getUniformLocation("u_seed"),
+        u_poisson_command_offset_loc = poisson_program->getUniformLocation("u_command_offset"),
+        u_poisson_command_capacity_loc = poisson_program->getUniformLocation("u_command_capacity"),
+        u_poisson_exclusion_loc = poisson_program->getUniformLocation("u_exclusion");
+    GLint u_cull_model_view_loc = cull_program->getUniformLocation("u_model_view"),
+        u_cull_proj_loc = cull_program->getUniformLocation("u_proj"),
+        u_cull_species_count_loc = cull_program->getUniformLocation("u_species_count"),
+        u_cull_occlusion_loc = cull_program->getUniformLocation("u_occlusion"),
+        u_cull_depth_pyramid_loc = cull_program->getUniformLocation("u_depth_pyramid"),
+        u_cull_pyramid_levels_loc = cull_program->getUniformLocation("u_pyramid_levels"),
+        u_cull_viewport_size_loc = cull_program->getUniformLocation("u_viewport_size");
+
+    static constexpr GLuint command_binding = 0;
+    static constexpr GLuint species_binding = 1;
+    static constexpr GLuint point_binding = 2;
+    static constexpr GLuint cell_binding = 3;
+
+    static constexpr GLuint cull_command_binding = 0;
+    static constexpr GLuint cull_point_binding = 1;
+    static constexpr GLuint cull_visible_command_binding = 2;
+    static constexpr GLuint cull_visible_point_binding = 3;
+    static constexpr GLuint cull_species_binding = 4;
+    /// Read by both the culling pass and the entity shader.
+    static constexpr GLuint instance_rect_binding = 5;
+
+    /// Vertex buffer bindings of vao: the mesh atlas, and the placed entities advanced once per instance.
+    static constexpr GLuint mesh_bind_index = 0;
+    static constexpr GLuint instance_bind_index = 1;
+    /// Units 0 and 1 hold the world data and the depth pyramid's source.
+    static constexpr GLuint depth_pyramid_tex_unit = 2;
+
+    static constexpr GLsizeiptr upload_alignment = 16;
+
+    /// Image unit of occupancy_texture in the placement passes.
+    static constexpr GLuint occupancy_image_unit = 0;
+    /// Texels of occupancy_texture along each side of the terrain's texture coordinates.
+    static constexpr GLsizei occupancy_size = 1024;
+
+    /// Upper bound on the Poisson disk cell grid along each axis; the cells grow when min_distance is smaller.
+    static constexpr int max_poisson_cells = 2048;
+    /// Cells a Poisson cell depends on along each direction: two per earlier phase, see poisson.comp.
+    static constexpr int poisson_dependency_cells = 16;
+
+    PlacementParameters params;
+
+    /// Placement of a fixed number of tiles around the camera, regenerated as it moves, instead of pos0 - pos1. The
+    /// pos0 - pos1 rectangle is placed in tiles too, so that changing it or marking part of it dirty only places the
+    /// affected tiles again. These are the values edited in the UI, a PlacementSet keeps the ones it was generated
+    /// with.
+    bool tiled {false};
+    float tile_size {0.05f};
+    int tile_radius {2};
+    int tile_slots {49};
+    int tiles_per_frame {2};
+    glm::mat4 parent_transform {1.0f};
+    glm::mat4 view_matrix {1.0f};
+    glm::mat4 proj_matrix {1.0f};
+
+    /// Draw only the entities inside the view frustum, as found by a culling pass every frame.
+    bool culling {true};
+    /// Also drop the entities hidden behind the terrain, using depth_pyramid.
+    bool occlusion {true};
+    const DepthPyramid *depth_pyramid {nullptr};
+    /// Read the visible counts back every frame, which waits for the GPU.
+    bool culling_stats {false};
+    GLuint64 visible_count {0};
+    GLuint64 placed_count {0};
+
+    /// Distance LOD of the Bayer mode: candidates beyond lod_distance from the camera are thinned out. The placement
+    /// is regenerated once the camera is lod_update_distance away from the position it was generated for.
+    bool lod {false};
+    float lod_distance {2.0f};
+    float lod_update_distance {0.25f};
+    glm::vec3 lod_camera_position {0.0f};
+
+    /// Keep the current set's spatial_index up to date with its placement.
+    bool spatial_indexing {false};
+    /// Radius of the queries around the camera shown in the UI, in texture coordinates.
+    float query_radius {0.02f};
+    std::optional<SpatialIndexBenchmark> spatial_index_benchmark;
+
+    /// Placement drawn, streamed and updated.
+    PlacementSet current_set;
+    /// Placement generated by generateEntitiesInBackground(), or the previous one once it has been swapped in.
+    PlacementSet pending_set;
+    /// Whether pending_set is being generated, from generateEntitiesInBackground() until it is swapped in.
+    bool pending_generation {false};
+    /// Signaled once the GPU has finished pending_set; empty until its last tile has been queued.
+    std::optional<GL::ObjectManager<GL::Fence>> pending_fence;
+
+    std::vector<MeshRange> meshes;
+
+    int benchmark_runs {10};
+    std::vector<BenchmarkResult> benchmark_results;
+
+    glm::ivec2 placement_local_size {4, 4};
+    GLint world_data_tex_unit {0};
+    GLint terrain_derivatives_tex_unit {0};
+    WorkGroupTuner work_group_tuner;
+    std::vector<WorkGroupTuner::Timing> autotune_results;
+
+    std::optional<CpuPlacement> cpu_placement;
+    /// Workers of the CPU placement, created when first needed; 0 threads means one per hardware thread.
+    std::optional<ThreadPool> cpu_pool;
+    int cpu_threads {0};
+    /// Place the entities with CpuPlacement instead of the compute passes, streaming them through upload_ring.
+    bool cpu_streaming {false};
+
+    /// Reject the candidates of a species inside the footprint of an entity of higher priority.
+    bool exclusion {true};
+    /// Per exclusion level, how far past a range its dispatch stamps footprints so that every footprint reaching the
+    /// lower levels is there, whichever tile they come from.
+    std::vector<float> exclusion_margins;
+    /// Farthest a footprint stamped for a range reaches past it.
+    float exclusion_reach {0.0f};
+    std::vector<ValidationResult> validation_results;
 };
 
 
-#endif //PROCEDURALPLACEMENT_ENTITIES_HPP
\ No newline at end of file
+#endif //PROCEDURALPLACEMENT_ENTITIES_HPP
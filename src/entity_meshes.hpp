@@ -0,0 +1,44 @@
+#ifndef PROCEDURALPLACEMENT_ENTITY_MESHES_HPP
+#define PROCEDURALPLACEMENT_ENTITY_MESHES_HPP
+
+#include "utils/cube.hpp"
+
+#include <glm/vec3.hpp>
+#include <glm/vec2.hpp>
+
+/// Vertical quads crossed at right angles, standing on the origin. Each quad is duplicated with the opposite winding,
+/// so both sides are drawn with back face culling.
+struct CrossedQuads {
+    using Vertex = Cube::Vertex;
+
+    static constexpr Vertex vertices[] {
+            {{-.5, 0., 0.}, { 0., 0., 1.}, {0., 1.}}, // 0
+            {{ .5, 0., 0.}, { 0., 0., 1.}, {1., 1.}},
+            {{-.5, 1., 0.}, { 0., 0., 1.}, {0., 0.}},
+            {{ .5, 1., 0.}, { 0., 0., 1.}, {1., 0.}},
+
+            {{-.5, 0., 0.}, { 0., 0.,-1.}, {0., 1.}}, // 4
+            {{ .5, 0., 0.}, { 0., 0.,-1.}, {1., 1.}},
+            {{-.5, 1., 0.}, { 0., 0.,-1.}, {0., 0.}},
+            {{ .5, 1., 0.}, { 0., 0.,-1.}, {1., 0.}},
+
+            {{0., 0., -.5}, { 1., 0., 0.}, {0., 1.}}, // 8
+            {{0., 0.,  .5}, { 1., 0., 0.}, {1., 1.}},
+            {{0., 1., -.5}, { 1., 0., 0.}, {0., 0.}},
+            {{0., 1.,  .5}, { 1., 0., 0.}, {1., 0.}},
+
+            {{0., 0., -.5}, {-1., 0., 0.}, {0., 1.}}, // 12
+            {{0., 0.,  .5}, {-1., 0., 0.}, {1., 1.}},
+            {{0., 1., -.5}, {-1., 0., 0.}, {0., 0.}},
+            {{0., 1.,  .5}, {-1., 0., 0.}, {1., 0.}},
+    };
+
+    static constexpr unsigned int indices[] {
+            0, 1, 2,    2, 1, 3,
+            5, 4, 6,    5, 6, 7,
+            9, 8, 10,   9, 10, 11,
+            12, 13, 14, 14, 13, 15,
+    };
+};
+
+#endif //PROCEDURALPLACEMENT_ENTITY_MESHES_HPP
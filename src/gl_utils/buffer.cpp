@@ -1,5 +1,8 @@
 #include "buffer.hpp"
 
+#include <algorithm>
+#include <stdexcept>
+
 namespace GL {
 
     Buffer Buffer::create() {
@@ -28,12 +31,93 @@ namespace GL {
         glNamedBufferData(id(), size, data, static_cast<GLenum>(usage));
     }
 
+    void Buffer::storage(GLsizeiptr size, const void *data, GLbitfield flags) const {
+        glNamedBufferStorage(id(), size, data, flags);
+    }
+
+    void *Buffer::map(GLintptr offset, GLsizeiptr size, GLbitfield access) const {
+        return glMapNamedBufferRange(id(), offset, size, access);
+    }
+
+    void Buffer::unmap() const {
+        glUnmapNamedBuffer(id());
+    }
+
     void Buffer::writeData(GLintptr offset, GLsizeiptr size, const void *data) const {
         glNamedBufferSubData(id(), offset, size, data);
     }
 
+    void Buffer::clearData(GLenum internal_format, GLenum format, GLenum type, const void *data) const {
+        glClearNamedBufferData(id(), internal_format, format, type, data);
+    }
+
+    void Buffer::readData(GLintptr offset, GLsizeiptr size, void *data) const {
+        glGetNamedBufferSubData(id(), offset, size, data);
+    }
+
+    void Buffer::copyData(const Buffer &source, GLintptr read_offset, GLintptr write_offset, GLsizeiptr size) const {
+        glCopyNamedBufferSubData(source.id(), id(), read_offset, write_offset, size);
+    }
+
     GLuint Buffer::id() const {
         return m_id;
     }
 
+    RingBuffer::RingBuffer(GLsizeiptr size) : m_size(size) {
+        constexpr GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        m_buffer->storage(size, nullptr, flags);
+        m_data = static_cast<char *>(m_buffer->map(0, size, flags));
+        if (!m_data)
+            throw std::runtime_error("RingBuffer: mapping the buffer failed");
+    }
+
+    RingBuffer::~RingBuffer() {
+        for (const auto &range : m_fences)
+            Fence::destroy(range.fence);
+        m_buffer->unmap();
+    }
+
+    RingBuffer::Region RingBuffer::allocate(GLsizeiptr size, GLsizeiptr alignment) {
+        if (size > m_size)
+            throw std::length_error("RingBuffer::allocate: region larger than the buffer");
+
+        GLintptr begin = (m_head + alignment - 1) / alignment * alignment;
+        if (begin + size > m_size) {
+            // the fenced ranges must not wrap around, so the regions before the end get their own fence
+            fence();
+            begin = 0;
+            m_unfenced_begin = 0;
+        }
+
+        const auto overlaps = [&](const FencedRange &range) {
+            return range.begin < begin + size && begin < range.end;
+        };
+        // the fences are signaled in order, so waiting for the oldest ones first never waits longer than needed
+        while (std::any_of(m_fences.begin(), m_fences.end(), overlaps)) {
+            const Fence fence = m_fences.front().fence;
+            fence.clientWait();
+            Fence::destroy(fence);
+            m_fences.pop_front();
+        }
+
+        m_head = begin + size;
+        return {begin, m_data + begin};
+    }
+
+    void RingBuffer::fence() {
+        if (m_head == m_unfenced_begin)
+            return;
+
+        m_fences.push_back({m_unfenced_begin, m_head, Fence::create()});
+        m_unfenced_begin = m_head;
+    }
+
+    Buffer RingBuffer::buffer() const {
+        return m_buffer.handle();
+    }
+
+    GLsizeiptr RingBuffer::size() const {
+        return m_size;
+    }
+
 } // GL
\ No newline at end of file
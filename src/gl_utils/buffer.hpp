@@ -3,6 +3,10 @@
 
 #include <glad/glad.h>
 
+#include "object_manager.hpp"
+#include "fence.hpp"
+
+#include <deque>
 #include <vector>
 
 namespace GL {
@@ -15,13 +19,16 @@ public:
         Array = GL_ARRAY_BUFFER,
         ElementArray = GL_ELEMENT_ARRAY_BUFFER,
         ShaderStorage = GL_SHADER_STORAGE_BUFFER,
-        DispatchIndirect = GL_DISPATCH_INDIRECT_BUFFER
+        DispatchIndirect = GL_DISPATCH_INDIRECT_BUFFER,
+        DrawIndirect = GL_DRAW_INDIRECT_BUFFER
     };
 
     enum class Usage {
         StreamDraw = GL_STREAM_DRAW,
         StaticDraw = GL_STATIC_DRAW,
         DynamicDraw = GL_DYNAMIC_DRAW,
+        StaticCopy = GL_STATIC_COPY,
+        DynamicCopy = GL_DYNAMIC_COPY,
     };
 
     Buffer() = default;
@@ -40,18 +47,39 @@ public:
     /// Allocate memory and initialize it to the contents of @p data.
     void initialize(GLsizeiptr size, const void *data, Usage usage) const;
 
+    /**
+     * @brief Allocate immutable storage, initialized to the contents of @p data unless it is null.
+     * @param flags Combination of GL_MAP_*_BIT and GL_DYNAMIC_STORAGE_BIT, see glNamedBufferStorage.
+     */
+    void storage(GLsizeiptr size, const void *data, GLbitfield flags) const;
+
+    /// Map @p size bytes starting at @p offset, with the GL_MAP_*_BIT flags in @p access.
+    [[nodiscard]] void *map(GLintptr offset, GLsizeiptr size, GLbitfield access) const;
+
+    void unmap() const;
+
     /// Write data to vertex_buffer starting at @p offset (measured in bytes).
     void writeData(GLintptr offset, GLsizeiptr size, const void *data) const;
 
+    /// Fill the whole buffer with a single value of the given format, e.g. (GL_R32F, GL_RED, GL_FLOAT).
+    void clearData(GLenum internal_format, GLenum format, GLenum type, const void *data) const;
+
+    /// Read back @p size bytes starting at @p offset into @p data.
+    void readData(GLintptr offset, GLsizeiptr size, void *data) const;
+
+    /// Copy @p size bytes of @p source starting at @p read_offset to this buffer at @p write_offset, without a round
+    /// trip through client memory.
+    void copyData(const Buffer &source, GLintptr read_offset, GLintptr write_offset, GLsizeiptr size) const;
+
     /**
      * @brief Allocate memory and initialize it to the contents of @p data.
      * @param data A contiguous container, such as std::vector.
      * @param usage OpenGL vertex_buffer usage hint.
      */
     template<class Container>
-    void initialize(Container data, Usage usage) const {
-        auto alignment = std::alignment_of_v<typename Container::value_type>;
-        initialize(data.size() * alignment, data.data(), usage);
+    void initialize(const Container &data, Usage usage) const {
+        auto element_size = sizeof(typename Container::value_type);
+        initialize(data.size() * element_size, data.data(), usage);
     }
 
     [[nodiscard]] GLuint id() const;
@@ -64,6 +92,61 @@ private:
 
 };
 
+/**
+ * @brief Persistently mapped buffer that the CPU writes as a ring, to stream data to the GPU.
+ *
+ * The storage is immutable and mapped once, coherently, so writing to it never reallocates nor synchronizes. Every
+ * region handed out by allocate() must be followed, once the commands reading it are queued, by a call to fence();
+ * allocate() only waits when it wraps onto a region whose fence hasn't been signaled yet.
+ */
+class RingBuffer {
+
+public:
+
+    struct Region {
+        /// Offset of the region in buffer(), for the commands that read it.
+        GLintptr offset;
+        void *data;
+    };
+
+    explicit RingBuffer(GLsizeiptr size);
+
+    ~RingBuffer();
+
+    RingBuffer(const RingBuffer &) = delete;
+
+    RingBuffer &operator=(const RingBuffer &) = delete;
+
+    /// Reserve @p size bytes, at most size(), starting at a multiple of @p alignment.
+    [[nodiscard]] Region allocate(GLsizeiptr size, GLsizeiptr alignment = 16);
+
+    /// Guard the regions allocated since the last call with a fence, after the commands that read them.
+    void fence();
+
+    [[nodiscard]] Buffer buffer() const;
+
+    [[nodiscard]] GLsizeiptr size() const;
+
+private:
+
+    /// Byte range [begin, end) in use by the GPU until fence is signaled.
+    struct FencedRange {
+        GLintptr begin;
+        GLintptr end;
+        Fence fence;
+    };
+
+    ObjectManager<Buffer> m_buffer {};
+    GLsizeiptr m_size;
+    char *m_data;
+    GLintptr m_head {0};
+    /// Start of the regions allocated since the last fence.
+    GLintptr m_unfenced_begin {0};
+    /// Oldest first.
+    std::deque<FencedRange> m_fences;
+
+};
+
 } // GL
 
 #endif //SRC_GL_UTILS__BUFFER_HPP
@@ -0,0 +1,29 @@
+#include "fence.hpp"
+
+namespace GL {
+
+Fence Fence::create() {
+    return Fence {glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0)};
+}
+
+void Fence::destroy(Fence fence) {
+    glDeleteSync(fence.m_sync);
+}
+
+bool Fence::valid() const {
+    return glIsSync(m_sync);
+}
+
+bool Fence::signaled() const {
+    return glClientWaitSync(m_sync, GL_SYNC_FLUSH_COMMANDS_BIT, 0) != GL_TIMEOUT_EXPIRED;
+}
+
+void Fence::clientWait() const {
+    while (glClientWaitSync(m_sync, GL_SYNC_FLUSH_COMMANDS_BIT, 1'000'000) == GL_TIMEOUT_EXPIRED);
+}
+
+GLsync Fence::id() const {
+    return m_sync;
+}
+
+} // GL
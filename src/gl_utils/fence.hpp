@@ -0,0 +1,40 @@
+#ifndef SRC_GL_UTILS__FENCE_HPP
+#define SRC_GL_UTILS__FENCE_HPP
+
+#include <glad/glad.h>
+
+namespace GL {
+
+/// Sync object signaled once the GPU has completed every command issued before it.
+class Fence {
+
+public:
+
+    Fence() = default;
+
+    /// Insert a fence after the commands issued so far.
+    static Fence create();
+
+    static void destroy(Fence fence);
+
+    [[nodiscard]] bool valid() const;
+
+    /// Whether the fence is signaled, without waiting. Flushes the commands so that it eventually is.
+    [[nodiscard]] bool signaled() const;
+
+    /// Wait on the CPU until the fence is signaled.
+    void clientWait() const;
+
+    [[nodiscard]] GLsync id() const;
+
+private:
+
+    explicit Fence(GLsync sync) : m_sync(sync) {}
+
+    GLsync m_sync {nullptr};
+
+};
+
+} // GL
+
+#endif //SRC_GL_UTILS__FENCE_HPP
@@ -0,0 +1,43 @@
+#include "framebuffer.hpp"
+
+namespace GL {
+
+Framebuffer Framebuffer::create() {
+    Framebuffer framebuffer;
+    glCreateFramebuffers(1, &framebuffer.m_id);
+    return framebuffer;
+}
+
+void Framebuffer::destroy(Framebuffer framebuffer) {
+    glDeleteFramebuffers(1, &framebuffer.m_id);
+}
+
+bool Framebuffer::valid() const {
+    return glIsFramebuffer(m_id);
+}
+
+void Framebuffer::bind(Target target) const {
+    glBindFramebuffer(static_cast<GLenum>(target), m_id);
+}
+
+void Framebuffer::unbind(Target target) {
+    glBindFramebuffer(static_cast<GLenum>(target), 0);
+}
+
+void Framebuffer::attachTexture(Attachment attachment, Texture texture, GLint level) const {
+    glNamedFramebufferTexture(m_id, static_cast<GLenum>(attachment), texture.id(), level);
+}
+
+void Framebuffer::setDrawBuffer(GLenum buffer) const {
+    glNamedFramebufferDrawBuffer(m_id, buffer);
+}
+
+bool Framebuffer::complete() const {
+    return glCheckNamedFramebufferStatus(m_id, GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+}
+
+GLuint Framebuffer::id() const {
+    return m_id;
+}
+
+} // GL
@@ -0,0 +1,60 @@
+#ifndef SRC_GL_UTILS__FRAMEBUFFER_HPP
+#define SRC_GL_UTILS__FRAMEBUFFER_HPP
+
+#include <glad/glad.h>
+
+#include "texture.hpp"
+
+namespace GL {
+
+class Framebuffer {
+
+public:
+
+    enum class Target {
+        Framebuffer = GL_FRAMEBUFFER,
+        Draw = GL_DRAW_FRAMEBUFFER,
+        Read = GL_READ_FRAMEBUFFER,
+    };
+
+    enum class Attachment {
+        Color0 = GL_COLOR_ATTACHMENT0,
+        Depth = GL_DEPTH_ATTACHMENT,
+        Stencil = GL_STENCIL_ATTACHMENT,
+        DepthStencil = GL_DEPTH_STENCIL_ATTACHMENT,
+    };
+
+    Framebuffer() = default;
+
+    static Framebuffer create();
+
+    static void destroy(Framebuffer framebuffer);
+
+    [[nodiscard]] bool valid() const;
+
+    void bind(Target target) const;
+
+    /// Bind the default framebuffer.
+    static void unbind(Target target);
+
+    void attachTexture(Attachment attachment, Texture texture, GLint level) const;
+
+    /// Select the color attachment written by draws, or GL_NONE for depth-only rendering.
+    void setDrawBuffer(GLenum buffer) const;
+
+    /// glCheckNamedFramebufferStatus == GL_FRAMEBUFFER_COMPLETE.
+    [[nodiscard]] bool complete() const;
+
+    [[nodiscard]] GLuint id() const;
+
+private:
+
+    explicit Framebuffer(GLuint id) : m_id(id) {}
+
+    GLuint m_id {0};
+
+};
+
+} // GL
+
+#endif //SRC_GL_UTILS__FRAMEBUFFER_HPP
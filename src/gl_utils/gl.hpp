@@ -9,6 +9,9 @@
 #include "buffer.hpp"
 #include "vertex_array.hpp"
 #include "texture.hpp"
+#include "query.hpp"
+#include "fence.hpp"
+#include "framebuffer.hpp"
 
 namespace GL {
 
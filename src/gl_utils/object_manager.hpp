@@ -34,6 +34,7 @@ public:
         Object::destroy(m_handle);
         m_handle = other.m_handle;
         other.m_handle = Object();
+        return *this;
     }
 
     Object handle() const {
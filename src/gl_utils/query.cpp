@@ -0,0 +1,37 @@
+#include "query.hpp"
+
+namespace GL {
+
+Query Query::create(Target target) {
+    Query query {0, target};
+    glCreateQueries(static_cast<GLenum>(target), 1, &query.m_id);
+    return query;
+}
+
+void Query::destroy(Query query) {
+    glDeleteQueries(1, &query.m_id);
+}
+
+bool Query::valid() const {
+    return glIsQuery(m_id);
+}
+
+void Query::begin() const {
+    glBeginQuery(static_cast<GLenum>(m_target), m_id);
+}
+
+void Query::end() const {
+    glEndQuery(static_cast<GLenum>(m_target));
+}
+
+GLuint64 Query::result() const {
+    GLuint64 value;
+    glGetQueryObjectui64v(m_id, GL_QUERY_RESULT, &value);
+    return value;
+}
+
+GLuint Query::id() const {
+    return m_id;
+}
+
+} // GL
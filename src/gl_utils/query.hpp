@@ -0,0 +1,47 @@
+#ifndef SRC_GL_UTILS__QUERY_HPP
+#define SRC_GL_UTILS__QUERY_HPP
+
+#include <glad/glad.h>
+
+namespace GL {
+
+class Query {
+
+public:
+
+    enum class Target {
+        TimeElapsed = GL_TIME_ELAPSED,
+        SamplesPassed = GL_SAMPLES_PASSED,
+        AnySamplesPassed = GL_ANY_SAMPLES_PASSED,
+        PrimitivesGenerated = GL_PRIMITIVES_GENERATED,
+    };
+
+    Query() = default;
+
+    static Query create(Target target);
+
+    static void destroy(Query query);
+
+    [[nodiscard]] bool valid() const;
+
+    void begin() const;
+
+    void end() const;
+
+    /// Wait for the query to finish and return its result (nanoseconds for Target::TimeElapsed).
+    [[nodiscard]] GLuint64 result() const;
+
+    [[nodiscard]] GLuint id() const;
+
+private:
+
+    Query(GLuint id, Target target) : m_id(id), m_target(target) {}
+
+    GLuint m_id {0};
+    Target m_target {Target::TimeElapsed};
+
+};
+
+} // GL
+
+#endif //SRC_GL_UTILS__QUERY_HPP
@@ -8,6 +8,12 @@ Texture Texture::create() {
     return texture;
 }
 
+Texture Texture::create(Target target) {
+    Texture texture;
+    glCreateTextures(static_cast<GLenum>(target), 1, &texture.m_id);
+    return texture;
+}
+
 void Texture::destroy(Texture texture) {
     glDeleteTextures(1, &texture.m_id);
 }
@@ -46,6 +52,16 @@ void Texture::generateMipmap(Texture::Target target) {
     glGenerateMipmap(static_cast<GLuint>(target));
 }
 
+void Texture::storage2D(GLsizei levels, InternalFormat internal_format, GLsizei width, GLsizei height) const {
+    glTextureStorage2D(m_id, levels, static_cast<GLenum>(internal_format), width, height);
+}
+
+void Texture::clearSubImage2D(GLint level, GLint x, GLint y, GLsizei width, GLsizei height,
+                              Format format, Type type, const void *data) const {
+    glClearTexSubImage(m_id, level, x, y, 0, width, height, 1, static_cast<GLenum>(format), static_cast<GLenum>(type),
+                       data);
+}
+
 void Texture::setDepthStencilMode(Texture::Target target, Texture::DepthStencilMode mode) {
     glTexParameteri(static_cast<GLenum>(target), GL_DEPTH_STENCIL_TEXTURE_MODE, static_cast<GLint>(mode));
 }
@@ -54,10 +70,18 @@ void Texture::setMinFilter(Texture::Target target, Texture::MinFilter filter_mod
     glTexParameteri(static_cast<GLenum>(target), GL_TEXTURE_MIN_FILTER, static_cast<GLint>(filter_mode));
 }
 
+void Texture::setMinFilter(MinFilter filter_mode) const {
+    glTextureParameteri(m_id, GL_TEXTURE_MIN_FILTER, static_cast<GLint>(filter_mode));
+}
+
 void Texture::setMaxFilter(Texture::Target target, Texture::MaxFilter max_filter) {
     glTexParameteri(static_cast<GLenum>(target), GL_TEXTURE_MAG_FILTER, static_cast<GLint>(max_filter));
 }
 
+void Texture::setMaxFilter(MaxFilter max_filter) const {
+    glTextureParameteri(m_id, GL_TEXTURE_MAG_FILTER, static_cast<GLint>(max_filter));
+}
+
 void Texture::setWrapMode(Texture::Target target, Texture::WrapAxis axis, Texture::WrapMode mode) {
     glTexParameteri(static_cast<GLenum>(target), static_cast<GLenum>(axis), static_cast<GLint>(mode));
 }
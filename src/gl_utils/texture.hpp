@@ -12,15 +12,6 @@ public:
 
     Texture() = default;
 
-    static Texture create();
-
-    static void destroy(Texture texture);
-
-    [[nodiscard]] bool valid() const;
-
-    /// Sets the active texture unit to @param i.
-    static void setActive(GLubyte i);
-
     /// Texture binding targets.
     enum class Target : GLenum {
         Tex1D = GL_TEXTURE_1D,
@@ -36,6 +27,18 @@ public:
         Tex2DMultisampleArray   = GL_TEXTURE_2D_MULTISAMPLE_ARRAY,
     };
 
+    static Texture create();
+
+    /// Create a texture whose target is fixed from the start, so it can be used with the DSA calls before any bind.
+    static Texture create(Target target);
+
+    static void destroy(Texture texture);
+
+    [[nodiscard]] bool valid() const;
+
+    /// Sets the active texture unit to @param i.
+    static void setActive(GLubyte i);
+
     void bind(Target target) const;
 
     static void unbind(Target target);
@@ -103,6 +106,8 @@ public:
         RGBA16UI = GL_RGBA16UI,
         RGBA32I = GL_RGBA32I,
         RGBA32UI = GL_RGBA32UI,
+        DepthComponent24 = GL_DEPTH_COMPONENT24,
+        DepthComponent32F = GL_DEPTH_COMPONENT32F,
     };
 
     enum class Format : GLenum {
@@ -168,6 +173,13 @@ public:
 
     static void generateMipmap(Target target);
 
+    /// Allocate immutable storage for @p levels mipmap levels of a 2D texture.
+    void storage2D(GLsizei levels, InternalFormat internal_format, GLsizei width, GLsizei height) const;
+
+    /// Fill a rectangle of level @p level of a 2D texture with a single value, given in @p format and @p type.
+    void clearSubImage2D(GLint level, GLint x, GLint y, GLsizei width, GLsizei height,
+                         Format format, Type type, const void* data) const;
+
     enum class DepthStencilMode : GLenum {
         DepthComponent  = GL_DEPTH_COMPONENT,
         StencilIndex    = GL_STENCIL_INDEX,
@@ -185,6 +197,7 @@ public:
     };
 
     static void setMinFilter(Target target, MinFilter filter_mode);
+    void setMinFilter(MinFilter filter_mode) const;
 
     enum class MaxFilter : GLenum {
         Nearest = GL_NEAREST,
@@ -192,6 +205,7 @@ public:
     };
 
     static void setMaxFilter(Target target, MaxFilter max_filter);
+    void setMaxFilter(MaxFilter max_filter) const;
 
     enum class WrapMode : GLenum {
         Repeat = GL_REPEAT,
@@ -38,6 +38,10 @@ void VertexArray::attribFormat(GLuint attrib_index, GLint size, GLenum type, boo
     glVertexArrayAttribFormat(m_id, attrib_index, size, type, normalized, relative_offset);
 }
 
+void VertexArray::attribIFormat(GLuint attrib_index, GLint size, GLenum type, GLuint relative_offset) const {
+    glVertexArrayAttribIFormat(m_id, attrib_index, size, type, relative_offset);
+}
+
 void VertexArray::bindElementBuffer(GL::Buffer buffer) const {
     glVertexArrayElementBuffer(m_id, buffer.id());
 }
@@ -50,4 +54,8 @@ void VertexArray::bindingDivisor(GLuint binding_index, GLuint divisor) const {
         glEnableVertexArrayAttrib(m_id, index);
     }
 
+    void VertexArray::disableAttrib(GLuint index) const {
+        glDisableVertexArrayAttrib(m_id, index);
+    }
+
 } // GL
\ No newline at end of file
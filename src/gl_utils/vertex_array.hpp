@@ -32,12 +32,17 @@ public:
 
     void attribFormat(GLuint attrib_index, GLint size, GLenum type, bool normalized, GLuint relative_offset) const;
 
+    /// Format of an attribute read as integers, without conversion to float.
+    void attribIFormat(GLuint attrib_index, GLint size, GLenum type, GLuint relative_offset) const;
+
     void bindingDivisor(GLuint binding_index, GLuint divisor) const;
 
     void bindElementBuffer(GL::Buffer buffer) const;
 
     void enableAttrib(GLuint index) const;
 
+    void disableAttrib(GLuint index) const;
+
 private:
 
     VertexArray(GLuint id) : m_id(id) {}
@@ -0,0 +1,173 @@
+#ifndef PROCEDURALPLACEMENT_PLACEMENT_PARAMETERS_HPP
+#define PROCEDURALPLACEMENT_PLACEMENT_PARAMETERS_HPP
+
+#include <glad/glad.h>
+
+#include <glm/vec2.hpp>
+#include <glm/vec4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/common.hpp>
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+/// Meshes of the entity mesh atlas, see entity_meshes.hpp.
+enum class EntityMesh : GLuint {
+    Cube,
+    /// Two vertical quads crossed at right angles, like a vegetation impostor.
+    CrossedQuads,
+};
+
+/**
+ * @brief Placement and rendering rules of one kind of entity.
+ *
+ * Layout must match the Species struct in the placement, culling and entity shaders; std430 rounds the stride of an
+ * array of them up to the 16 byte alignment of the vec4 members.
+ */
+struct alignas(16) Species {
+    /// The density of a candidate is dot(density_weights, world_data sample) + density_bias.
+    glm::vec4 density_weights;
+    glm::vec4 color;
+    float density_bias;
+    /// Candidates with a density below this value are always rejected.
+    float threshold;
+    /// Only the candidates of every spacing-th lattice cell along each axis are considered (Bayer mode).
+    GLuint spacing;
+    /// Minimum distance between two entities, in texture coordinates (Poisson disk mode).
+    float min_distance;
+    EntityMesh mesh {EntityMesh::Cube};
+    /// Size of the mesh in world units; it isn't affected by the parent transform.
+    float mesh_scale {0.02f};
+    /// Each entity's scale is mesh_scale times a factor in [1 - scale_variation, 1 + scale_variation].
+    float scale_variation {0.2f};
+    /// Radius of a sphere around the entity's position that contains its mesh at any scale, in world units. Derived
+    /// from mesh, mesh_scale and scale_variation when the species are uploaded.
+    float bounding_radius {0.0f};
+    /// Species of a higher priority are placed first, and keep the ones of lower priorities out of their footprint.
+    GLint priority {0};
+    /// Radius around each entity where no entity of a lower priority species is placed, in texture coordinates.
+    float footprint {0.0f};
+    /// Rank of priority among the species' distinct priorities, 0 for the highest. Derived when the species are
+    /// uploaded.
+    GLuint exclusion_level {0};
+    /// Candidates are only kept where the world data height is within [min_altitude, max_altitude].
+    float min_altitude {0.0f};
+    float max_altitude {1.0f};
+    /// Range of the terrain's slope, 1 minus the y of its world space normal: 0 on flat ground, towards 1 on cliffs.
+    float min_slope {0.0f};
+    float max_slope {1.0f};
+    /// Range of the Laplacian of the terrain's world space height: negative on ridges and peaks, positive in valleys.
+    float min_curvature {std::numeric_limits<float>::lowest()};
+    float max_curvature {std::numeric_limits<float>::max()};
+
+    /// Whether the candidate passes the altitude, slope and curvature rules; see Terrain::derivativeTexture().
+    [[nodiscard]] bool acceptsTerrain(float altitude, float slope, float curvature) const {
+        return altitude >= min_altitude && altitude <= max_altitude && slope >= min_slope && slope <= max_slope &&
+               curvature >= min_curvature && curvature <= max_curvature;
+    }
+};
+
+/// Rectangle of texture coordinates that the positions of a PackedInstance are relative to.
+struct InstanceRect {
+    glm::vec2 origin;
+    glm::vec2 size;
+};
+
+/**
+ * @brief Entity as written by the placement passes, 8 bytes.
+ *
+ * xz holds the position relative to its InstanceRect as two unorm16 (x in the low bits), and height_attributes the
+ * world data height as a unorm16 in its low bits, then the attributes hashed from the candidate: yaw (8 bits), scale
+ * (4 bits) and variant (4 bits). Matches packInstance in the placement shaders.
+ */
+struct PackedInstance {
+    GLuint xz;
+    GLuint height_attributes;
+
+    /// Pack like packInstance: @p position relative to @p rect, with the height in y, and 16 bits of attributes.
+    [[nodiscard]] static PackedInstance pack(glm::vec3 position, const InstanceRect &rect, GLuint attributes) {
+        constexpr float unorm16_max = 65535.0f;
+        const auto unorm16 = [](float value) {
+            return static_cast<GLuint>(std::lround(glm::clamp(value, 0.0f, 1.0f) * unorm16_max));
+        };
+        const glm::vec2 relative = (glm::vec2(position.x, position.z) - rect.origin) / rect.size;
+        return {unorm16(relative.x) | unorm16(relative.y) << 16, unorm16(position.y) | attributes << 16};
+    }
+
+    /// Position in texture coordinates, with the height in y, like the CPU placement's.
+    [[nodiscard]] glm::vec3 position(const InstanceRect &rect) const {
+        constexpr float unorm16_max = 65535.0f;
+        const glm::vec2 relative {static_cast<float>(xz & 0xffffu) / unorm16_max,
+                                  static_cast<float>(xz >> 16) / unorm16_max};
+        const glm::vec2 tex_coord = rect.origin + relative * rect.size;
+        return {tex_coord.x, static_cast<float>(height_attributes & 0xffffu) / unorm16_max, tex_coord.y};
+    }
+
+    /// The attributes passed to pack().
+    [[nodiscard]] GLuint attributes() const {
+        return height_attributes >> 16;
+    }
+};
+
+enum class PlacementMode : int {
+    /// Ordered dithering of a jittered lattice of candidates.
+    Bayer,
+    /// Dart throwing with a minimum distance between entities of the same species.
+    PoissonDisk,
+};
+
+/// Parameters shared by the GPU and CPU placement paths.
+struct PlacementParameters {
+    /// Maximum number of species placed by a single dispatch (gc_max_species in placement.comp).
+    static constexpr int max_species = 32;
+
+    glm::vec2 pos0 {.3f, .25f};
+    glm::vec2 pos1 {.5f, .6f};
+    /// Side of the cells of the Bayer mode's candidate lattice, in texture coordinates. The lattice is anchored at the
+    /// origin of the map, so a candidate doesn't depend on the rectangle or the tile it is generated for.
+    float candidate_spacing {0.005f};
+    /// Seed of the jitter and thresholds hashed from each candidate's lattice cell.
+    GLuint seed {0};
+    PlacementMode mode {PlacementMode::Bayer};
+    /// Side of the Bayer matrix the thresholds are dithered with, a power of two from 2 to 16 (DITHER_SIZE in
+    /// placement.comp). Larger matrices have more threshold levels but repeat less often.
+    int dither_size {4};
+    int poisson_trials {8};
+
+    std::vector<Species> species {
+        {{0.0f, -1.0f, 1.0f, 0.0f}, {1.0f, 1.0f, 1.0f, 1.0f}, 0.0f, 0.0f, 1, 0.002f, EntityMesh::Cube, 0.01f, 0.0f},
+        {{0.0f, -1.0f, 1.0f, 0.0f}, {0.2f, 0.6f, 0.2f, 1.0f}, 0.0f, 0.5f, 4, 0.01f, EntityMesh::CrossedQuads, 0.06f, 0.3f,
+         0.0f, 1, 0.01f},
+    };
+
+    /// Lattice cells of the Bayer mode candidates of a rectangle.
+    struct CellRange {
+        glm::ivec2 first;
+        glm::ivec2 count;
+    };
+
+    /**
+     * @brief Cells with their corner in [rect_pos0, rect_pos1) and inside the map.
+     *
+     * Adjacent rectangles get disjoint ranges, as long as the shared edge is passed as the same value to both.
+     */
+    [[nodiscard]] CellRange cellRange(glm::vec2 rect_pos0, glm::vec2 rect_pos1) const {
+        const glm::ivec2 map_cells = glm::ceil(glm::vec2(1.0f / candidate_spacing));
+        const glm::ivec2 first = glm::clamp(glm::ivec2(glm::ceil(rect_pos0 / candidate_spacing)), glm::ivec2(0), map_cells);
+        const glm::ivec2 end = glm::clamp(glm::ivec2(glm::ceil(rect_pos1 / candidate_spacing)), glm::ivec2(0), map_cells);
+        return {first, glm::max(end - first, 0)};
+    }
+
+    /// Rectangle covering every candidate of a cell range: the cells' jitter keeps each candidate inside its cell.
+    [[nodiscard]] InstanceRect cellRect(const CellRange &range) const {
+        return {glm::vec2(range.first) * candidate_spacing, glm::vec2(range.count) * candidate_spacing};
+    }
+
+    /// Upper bound on the cells of cellRange() along each axis, for any rectangle of the given size.
+    [[nodiscard]] glm::ivec2 maxCellCount(glm::vec2 rect_size) const {
+        return glm::ivec2(glm::ceil(rect_size / candidate_spacing)) + 1;
+    }
+};
+
+#endif //PROCEDURALPLACEMENT_PLACEMENT_PARAMETERS_HPP
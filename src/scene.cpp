@@ -13,14 +13,24 @@ Scene::Scene() {
     glBindTextureUnit(tex_unit, world_data_texture->id());
     terrain.setWorldDataTexUnit(tex_unit);
     entities.setWorldDataTexUnit(tex_unit);
+    entities.setWorldData(world_data_image);
+    entities.setDepthPyramid(&depth_pyramid);
 
     terrain.generateMesh();
-    entities.generateEntities();
 
     auto terrain_transform = glm::scale(glm::mat4(1.0f), {10, 0.52, 7.62});
     terrain_transform = glm::translate(terrain_transform, {-.5, 0, -.5});
     terrain.setParentTransform(terrain_transform);
     entities.setParentTransform(glm::translate(terrain_transform, {0.0f, 0.1f, 0.0f}));
+
+    // in world units, so once the terrain has its transform; units 1 and 2 are used by the depth pyramid and culling
+    constexpr unsigned int derivatives_tex_unit = 3;
+    terrain.generateDerivatives(world_data_image.dimensions());
+    glBindTextureUnit(derivatives_tex_unit, terrain.derivativeTexture().id());
+    terrain.setDerivativesTexUnit(derivatives_tex_unit);
+    entities.setTerrainDerivatives(terrain.derivativeTexture(), derivatives_tex_unit);
+
+    entities.generateEntities();
 }
 
 
@@ -83,13 +93,17 @@ void Scene::update(GLFWwindow *w, double delta) {
         m_proj_changed = false;
     }
 
-    axes.draw();
-
     ImGui::Separator();
     terrain.update(w, camera, delta);
 
+    // the terrain is the only occluder of the entities, and so far the only thing drawn
+    if (entities.occlusionCulling())
+        depth_pyramid.build(camera.screen_size);
+
+    axes.draw();
+
     ImGui::Separator();
-    entities.update();
+    entities.update(camera);
 
     ImGui::End();
 }
\ No newline at end of file
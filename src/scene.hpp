@@ -13,6 +13,7 @@
 #include "terrain.hpp"
 #include "axes.hpp"
 #include "entities.hpp"
+#include "depth_pyramid.hpp"
 
 class Scene {
 public:
@@ -36,8 +37,12 @@ private:
     Terrain terrain;
     Axes axes;
     Entities entities;
+    /// Terrain depth, used to cull the entities hidden behind it.
+    DepthPyramid depth_pyramid;
 
-    GL::ObjectManager<GL::Texture> world_data_texture {loadTexture("textures/world_data.png")};
+    /// Kept on the CPU for the CPU placement.
+    Image world_data_image {"textures/world_data.png"};
+    GL::ObjectManager<GL::Texture> world_data_texture {loadTexture(world_data_image)};
 };
 
 
@@ -0,0 +1,14 @@
+#version 460
+
+in vec4 f_color;
+in vec3 f_normal;
+
+uniform vec3 u_light_direction = vec3(0.32, 0.9, 0.28);
+uniform float u_ambient_strength = 0.35;
+
+out vec4 finalColor;
+
+void main() {
+    const float diffuse = max(dot(normalize(f_normal), normalize(u_light_direction)), 0.0f);
+    finalColor = vec4(f_color.rgb * (u_ambient_strength + (1.0f - u_ambient_strength) * diffuse), f_color.a);
+}
@@ -0,0 +1,75 @@
+#version 460
+
+// mesh vertex
+in vec3 a_position;
+in vec3 a_normal;
+// placed entity, advanced once per instance: a PackedInstance
+in uvec2 a_instance;
+
+struct Species {
+    vec4 density_weights;
+    vec4 color;
+    float density_bias;
+    float threshold;
+    uint spacing;
+    float min_distance;
+    uint mesh;
+    float mesh_scale;
+    float scale_variation;
+    float bounding_radius;
+    int priority;
+    float footprint;
+    uint exclusion_level;
+    float min_altitude;
+    float max_altitude;
+    float min_slope;
+    float max_slope;
+    float min_curvature;
+    float max_curvature;
+};
+
+layout (std430, binding = 1) restrict readonly
+buffer SpeciesTable {
+    Species species[];
+} b_species;
+
+// InstanceRect of each slot: origin in xy, size in zw
+layout (std430, binding = 5) restrict readonly
+buffer InstanceRects {
+    vec4 rects[];
+} b_rects;
+
+uniform mat4 u_model;
+uniform mat4 u_view;
+uniform mat4 u_proj;
+uniform uint u_species_count = 1;
+
+out vec4 f_color;
+out vec3 f_normal;
+
+const float gc_pi = 3.14159265f;
+
+void main() {
+    // each species of each tile is drawn by its own command of the multi-draw
+    const Species sp = b_species.species[gl_DrawID % u_species_count];
+    const vec4 rect = b_rects.rects[gl_DrawID / u_species_count];
+
+    const vec2 tex_coord = rect.xy + unpackUnorm2x16(a_instance.x) * rect.zw;
+    const vec3 instance_position = vec3(tex_coord.x, unpackUnorm2x16(a_instance.y).x, tex_coord.y);
+
+    const uint attributes = a_instance.y >> 16;
+    const float yaw = float(attributes & 0xffu) * (2 * gc_pi / 256);
+    const float scale = sp.mesh_scale * (1 + sp.scale_variation * (float((attributes >> 8) & 0xfu) / 7.5f - 1));
+    const uint variant = attributes >> 12;
+
+    const mat3 rotation = mat3(cos(yaw), 0, -sin(yaw), 0, 1, 0, sin(yaw), 0, cos(yaw));
+
+    // the mesh is scaled in world units, after the parent transform has placed the entity
+    const vec4 base = u_model * vec4(instance_position, 1.0f);
+    const vec3 world_position = base.xyz / base.w + rotation * a_position * scale;
+
+    gl_Position = u_proj * u_view * vec4(world_position, 1.0f);
+    // until species have several meshes, the variant only shades the color
+    f_color = vec4(sp.color.rgb * (0.85f + 0.3f * float(variant) / 15), sp.color.a);
+    f_normal = rotation * a_normal;
+}
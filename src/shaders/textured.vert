@@ -3,19 +3,97 @@
 layout (location = 0) in vec3 a_position;
 layout (location = 1) in vec3 a_normal;
 layout (location = 2) in vec2 a_texCoord;
+// compact vertices, see packVertex in heightmap.comp
+layout (location = 3) in uint a_packed;
 
 layout (location = 0) uniform mat4 u_model;
 layout (location = 1) uniform mat4 u_view;
 layout (location = 2) uniform mat4 u_projection;
 
+// Compact vertices only hold the height and the normal: the rest is derived from gl_VertexID, the index of the vertex
+// among the u_gridSize vertices of every chunk, chunk n being the node n of Terrain's quadtree.
+uniform bool u_compactVertices = false;
+// Procedural vertices have no attributes at all: the height is also fetched from u_worldData, as heightmap.comp does,
+// and the normal from u_terrainDerivatives, so changing the grid only takes new uniforms.
+uniform bool u_proceduralVertices = false;
+uniform sampler2D u_worldData;
+// Terrain::derivativeTexture(): dh/dx and dh/dz in world units, through the scale of u_model
+uniform sampler2D u_terrainDerivatives;
+uniform uvec2 u_gridSize;
+// chunks have a skirt ring when u_skirtDepth > 0, like in heightmap.comp
+uniform float u_skirtDepth = 0;
+
 out vec3 f_normal;
 out vec3 f_position;
 out vec2 f_texCoord;
 
+// origin and size of quadtree node n, whose children are 4n + 1 to 4n + 4, walking up to the root
+vec3 nodeRect(uint node) {
+    vec2 origin = vec2(0);
+    float size = 1;
+    while (node > 0) {
+        const uint child = (node - 1) % 4;
+        origin = (vec2(child % 2, child / 2) + origin) * 0.5f;
+        size *= 0.5f;
+        node = (node - 1) / 4;
+    }
+    return vec3(origin, size);
+}
+
+vec3 octDecode(vec2 e) {
+    vec3 n = vec3(e.x, 1 - abs(e.x) - abs(e.y), e.y);
+    if (n.y < 0) {
+        const vec2 signs = vec2(n.x >= 0 ? 1 : -1, n.z >= 0 ? 1 : -1);
+        n.xz = (1 - abs(n.zx)) * signs;
+    }
+    return normalize(n);
+}
+
+// texture coordinates of a vertex of a chunk covering rect, without its skirt
+vec2 texCoord(vec3 rect, ivec2 id, ivec2 surface_size) {
+    return rect.xy + rect.z * vec2(id) / vec2(surface_size - 1);
+}
+
+// a single fetch of the precomputed gradient; scaling the normal it gives by the axes of u_model brings it back to the
+// model space the vertex attributes' normals are in
+vec3 derivativeNormal(vec2 tex_coord) {
+    const vec2 gradient = texture(u_terrainDerivatives, tex_coord).xy;
+    const vec3 scale = vec3(length(u_model[0].xyz), length(u_model[1].xyz), length(u_model[2].xyz));
+    return normalize(vec3(-gradient.x, 1, -gradient.y) * scale);
+}
+
 void main() {
-    gl_Position = u_projection * u_view * u_model * vec4(a_position, 1.0);
+    vec3 position = a_position;
+    vec3 normal = a_normal;
+    vec2 tex_coord = a_texCoord;
+
+    if (u_compactVertices || u_proceduralVertices) {
+        const uint grid_vertices = u_gridSize.x * u_gridSize.y;
+        const uint index = uint(gl_VertexID) % grid_vertices;
+        const ivec2 grid_id = ivec2(index % u_gridSize.x, index / u_gridSize.x);
+        const vec3 rect = nodeRect(uint(gl_VertexID) / grid_vertices);
+
+        // the skirt ring repeats the surface's vertex next to it
+        const bool skirt = u_skirtDepth > 0;
+        const ivec2 surface_size = ivec2(u_gridSize) - (skirt ? 2 : 0);
+        const ivec2 id = skirt ? clamp(grid_id - 1, ivec2(0), surface_size - 1) : grid_id;
+        const bool on_skirt = skirt && any(notEqual(grid_id - 1, id));
+
+        tex_coord = texCoord(rect, id, surface_size);
+        float height;
+        if (u_proceduralVertices) {
+            height = texture(u_worldData, tex_coord).r;
+            normal = derivativeNormal(tex_coord);
+        } else {
+            height = unpackUnorm2x16(a_packed).x;
+            normal = octDecode(unpackUnorm4x8(a_packed >> 16).xy * 2 - 1);
+        }
+        position = vec3(tex_coord.x, on_skirt ? height - u_skirtDepth : height, tex_coord.y);
+    }
+
+    gl_Position = u_projection * u_view * u_model * vec4(position, 1.0);
 
-    f_normal = mat3(transpose(inverse(u_model))) * a_normal;
-    f_position = vec3(u_model * vec4(a_position, 1.0));
-    f_texCoord = a_texCoord;
-}
\ No newline at end of file
+    f_normal = mat3(transpose(inverse(u_model))) * normal;
+    f_position = vec3(u_model * vec4(position, 1.0));
+    f_texCoord = tex_coord;
+}
@@ -0,0 +1,277 @@
+#include "spatial_index.hpp"
+
+#include <glm/common.hpp>
+#include <glm/vector_relational.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+/// Queries answered by each task of a batch split over a ThreadPool.
+constexpr std::size_t queries_per_task = 256;
+
+} // namespace
+
+std::span<const SpatialIndex::Hit> SpatialIndex::Results::operator[](std::size_t query) const {
+    return {hits.data() + offsets[query], hits.data() + offsets[query + 1]};
+}
+
+std::size_t SpatialIndex::Results::queryCount() const {
+    return offsets.empty() ? 0 : offsets.size() - 1;
+}
+
+glm::ivec2 SpatialIndex::Tile::cell(glm::vec2 point) const {
+    return glm::clamp(glm::ivec2(glm::floor((point - bounds_min) / cell_size)), glm::ivec2(0), cell_count - 1);
+}
+
+void SpatialIndex::setTile(int tile, std::span<const glm::vec3> positions, std::span<const std::uint32_t> species) {
+    if (positions.size() != species.size())
+        throw std::invalid_argument("SpatialIndex::setTile: one species per position is needed");
+
+    eraseTile(tile);
+    if (positions.empty())
+        return;
+
+    Tile t;
+    t.bounds_min = glm::vec2(std::numeric_limits<float>::max());
+    t.bounds_max = glm::vec2(std::numeric_limits<float>::lowest());
+    for (const auto &position : positions) {
+        t.bounds_min = glm::min(t.bounds_min, glm::vec2(position.x, position.z));
+        t.bounds_max = glm::max(t.bounds_max, glm::vec2(position.x, position.z));
+    }
+
+    // cells sized for entities_per_cell entities on average, and never empty of area
+    const glm::vec2 extent = glm::max(t.bounds_max - t.bounds_min, glm::vec2(1e-6f));
+    t.cell_size = std::sqrt(extent.x * extent.y * entities_per_cell / static_cast<float>(positions.size()));
+    t.cell_size = std::max({t.cell_size, extent.x / 1024.0f, extent.y / 1024.0f});
+    t.cell_count = glm::max(glm::ivec2(glm::ceil(extent / t.cell_size)), 1);
+
+    // counting sort by cell
+    const auto cell_total = static_cast<std::size_t>(t.cell_count.x) * t.cell_count.y;
+    std::vector<std::uint32_t> cells(positions.size());
+    t.cell_start.assign(cell_total + 1, 0);
+    for (std::size_t i = 0; i < positions.size(); i++) {
+        const glm::ivec2 cell = t.cell({positions[i].x, positions[i].z});
+        cells[i] = cell.y * t.cell_count.x + cell.x;
+        t.cell_start[cells[i] + 1]++;
+    }
+    for (std::size_t c = 0; c < cell_total; c++)
+        t.cell_start[c + 1] += t.cell_start[c];
+
+    t.x.resize(positions.size());
+    t.z.resize(positions.size());
+    t.height.resize(positions.size());
+    t.species.resize(positions.size());
+    std::vector<std::uint32_t> next(t.cell_start.begin(), t.cell_start.end() - 1);
+    for (std::size_t i = 0; i < positions.size(); i++) {
+        const std::uint32_t index = next[cells[i]]++;
+        t.x[index] = positions[i].x;
+        t.z[index] = positions[i].z;
+        t.height[index] = positions[i].y;
+        t.species[index] = species[i];
+    }
+
+    m_size += positions.size();
+    m_tiles.emplace(tile, std::move(t));
+}
+
+void SpatialIndex::eraseTile(int tile) {
+    const auto it = m_tiles.find(tile);
+    if (it == m_tiles.end())
+        return;
+    m_size -= it->second.x.size();
+    m_tiles.erase(it);
+}
+
+void SpatialIndex::clear() {
+    m_tiles.clear();
+    m_size = 0;
+}
+
+std::size_t SpatialIndex::size() const {
+    return m_size;
+}
+
+void SpatialIndex::radius(std::span<const glm::vec2> centers, float radius, Results &results,
+                          std::uint32_t species_mask) const {
+    runBatch(centers.size(), [&](std::size_t i, std::vector<Hit> &hits) {
+        queryBox(centers[i] - radius, centers[i] + radius, radius * radius, centers[i], species_mask, hits);
+    }, results);
+}
+
+void SpatialIndex::box(std::span<const glm::vec2> box_min, std::span<const glm::vec2> box_max, Results &results,
+                       std::uint32_t species_mask) const {
+    runBatch(box_min.size(), [&](std::size_t i, std::vector<Hit> &hits) {
+        queryBox(box_min[i], box_max[i], std::numeric_limits<float>::infinity(), box_min[i], species_mask, hits);
+    }, results);
+}
+
+void SpatialIndex::nearest(std::span<const glm::vec2> points, int k, Results &results,
+                           std::uint32_t species_mask) const {
+    runBatch(points.size(), [&](std::size_t i, std::vector<Hit> &hits) {
+        queryNearest(points[i], k, species_mask, hits);
+    }, results);
+}
+
+void SpatialIndex::radius(std::span<const glm::vec2> centers, float radius, Results &results, ThreadPool &pool,
+                          std::uint32_t species_mask) const {
+    runBatch(centers.size(), [&](std::size_t i, std::vector<Hit> &hits) {
+        queryBox(centers[i] - radius, centers[i] + radius, radius * radius, centers[i], species_mask, hits);
+    }, results, pool);
+}
+
+void SpatialIndex::box(std::span<const glm::vec2> box_min, std::span<const glm::vec2> box_max, Results &results,
+                       ThreadPool &pool, std::uint32_t species_mask) const {
+    runBatch(box_min.size(), [&](std::size_t i, std::vector<Hit> &hits) {
+        queryBox(box_min[i], box_max[i], std::numeric_limits<float>::infinity(), box_min[i], species_mask, hits);
+    }, results, pool);
+}
+
+void SpatialIndex::nearest(std::span<const glm::vec2> points, int k, Results &results, ThreadPool &pool,
+                           std::uint32_t species_mask) const {
+    runBatch(points.size(), [&](std::size_t i, std::vector<Hit> &hits) {
+        queryNearest(points[i], k, species_mask, hits);
+    }, results, pool);
+}
+
+void SpatialIndex::runBatch(std::size_t query_count, const Query &query, Results &results) {
+    results.offsets.assign(1, 0);
+    results.hits.clear();
+    for (std::size_t i = 0; i < query_count; i++) {
+        query(i, results.hits);
+        results.offsets.push_back(results.hits.size());
+    }
+}
+
+void SpatialIndex::runBatch(std::size_t query_count, const Query &query, Results &results, ThreadPool &pool) {
+    // each task answers a contiguous run of queries, and the runs are concatenated in order
+    std::vector<Results> partial((query_count + queries_per_task - 1) / queries_per_task);
+    std::vector<ThreadPool::Task> tasks;
+    for (std::size_t t = 0; t < partial.size(); t++) {
+        tasks.emplace_back([&, t] {
+            const std::size_t begin = t * queries_per_task;
+            const std::size_t end = std::min(begin + queries_per_task, query_count);
+            partial[t].offsets.assign(1, 0);
+            for (std::size_t i = begin; i < end; i++) {
+                query(i, partial[t].hits);
+                partial[t].offsets.push_back(partial[t].hits.size());
+            }
+        });
+    }
+    pool.run(std::move(tasks));
+
+    std::size_t hit_count = 0;
+    for (const auto &part : partial)
+        hit_count += part.hits.size();
+
+    results.offsets.assign(1, 0);
+    results.offsets.reserve(query_count + 1);
+    results.hits.clear();
+    results.hits.reserve(hit_count);
+    for (const auto &part : partial) {
+        const std::size_t base = results.hits.size();
+        for (std::size_t i = 1; i < part.offsets.size(); i++)
+            results.offsets.push_back(base + part.offsets[i]);
+        results.hits.insert(results.hits.end(), part.hits.begin(), part.hits.end());
+    }
+}
+
+void SpatialIndex::queryBox(glm::vec2 box_min, glm::vec2 box_max, float radius_squared, glm::vec2 center,
+                            std::uint32_t species_mask, std::vector<Hit> &hits) const {
+    for (const auto &[id, tile] : m_tiles) {
+        if (glm::any(glm::lessThan(box_max, tile.bounds_min)) || glm::any(glm::lessThan(tile.bounds_max, box_min)))
+            continue;
+
+        const glm::ivec2 first = tile.cell(box_min);
+        const glm::ivec2 last = tile.cell(box_max);
+        for (int cy = first.y; cy <= last.y; cy++) {
+            // the cells of a row are contiguous, and so are their entities
+            const std::uint32_t begin = tile.cell_start[cy * tile.cell_count.x + first.x];
+            const std::uint32_t end = tile.cell_start[cy * tile.cell_count.x + last.x + 1];
+            for (std::uint32_t i = begin; i < end; i++) {
+                const float x = tile.x[i];
+                const float z = tile.z[i];
+                const float dx = x - center.x;
+                const float dz = z - center.y;
+                const bool inside = x >= box_min.x && x <= box_max.x && z >= box_min.y && z <= box_max.y &&
+                        dx * dx + dz * dz <= radius_squared;
+                if (inside && (species_mask >> tile.species[i] & 1u))
+                    hits.push_back({{x, tile.height[i], z}, tile.species[i]});
+            }
+        }
+    }
+}
+
+void SpatialIndex::queryNearest(glm::vec2 point, int k, std::uint32_t species_mask, std::vector<Hit> &hits) const {
+    if (k <= 0)
+        return;
+
+    // max-heap of the k closest so far
+    std::vector<std::pair<float, Hit>> best;
+    const auto farther = [](const std::pair<float, Hit> &a, const std::pair<float, Hit> &b) {
+        return a.first < b.first;
+    };
+    const auto bound = [&] {
+        return best.size() < static_cast<std::size_t>(k) ? std::numeric_limits<float>::infinity() : best.front().first;
+    };
+
+    // the tiles closest to the point first, so that the farther ones are mostly skipped
+    std::vector<std::pair<float, const Tile *>> tiles;
+    for (const auto &[id, tile] : m_tiles) {
+        const glm::vec2 offset = glm::max(glm::max(tile.bounds_min - point, point - tile.bounds_max), glm::vec2(0.0f));
+        tiles.emplace_back(offset.x * offset.x + offset.y * offset.y, &tile);
+    }
+    std::sort(tiles.begin(), tiles.end(), [](const auto &a, const auto &b) {
+        return a.first < b.first;
+    });
+
+    for (const auto &[tile_distance, tile] : tiles) {
+        if (tile_distance > bound())
+            break;
+
+        // rings of cells around the point's, each at least (ring - 1) cells away from it
+        const glm::ivec2 center = tile->cell(point);
+        const int max_ring = std::max({center.x, center.y, tile->cell_count.x - 1 - center.x,
+                                       tile->cell_count.y - 1 - center.y});
+        for (int ring = 0; ring <= max_ring; ring++) {
+            const float ring_distance = static_cast<float>(std::max(ring - 1, 0)) * tile->cell_size;
+            if (ring_distance * ring_distance > bound())
+                break;
+
+            const glm::ivec2 first = glm::max(center - ring, 0);
+            const glm::ivec2 last = glm::min(center + ring, tile->cell_count - 1);
+            for (int cy = first.y; cy <= last.y; cy++) {
+                const bool edge_row = cy == center.y - ring || cy == center.y + ring;
+                for (int cx = first.x; cx <= last.x; cx++) {
+                    // only the cells on the ring itself, the inner ones were visited before
+                    if (!edge_row && cx != center.x - ring && cx != center.x + ring)
+                        continue;
+
+                    const std::uint32_t cell = cy * tile->cell_count.x + cx;
+                    for (std::uint32_t i = tile->cell_start[cell]; i < tile->cell_start[cell + 1]; i++) {
+                        const float dx = tile->x[i] - point.x;
+                        const float dz = tile->z[i] - point.y;
+                        const float distance = dx * dx + dz * dz;
+                        if (distance >= bound() || !(species_mask >> tile->species[i] & 1u))
+                            continue;
+
+                        if (best.size() == static_cast<std::size_t>(k)) {
+                            std::pop_heap(best.begin(), best.end(), farther);
+                            best.pop_back();
+                        }
+                        best.emplace_back(distance, Hit {{tile->x[i], tile->height[i], tile->z[i]}, tile->species[i]});
+                        std::push_heap(best.begin(), best.end(), farther);
+                    }
+                }
+            }
+        }
+    }
+
+    std::sort_heap(best.begin(), best.end(), farther);
+    for (const auto &[distance, hit] : best)
+        hits.push_back(hit);
+}
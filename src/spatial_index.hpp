@@ -0,0 +1,121 @@
+#ifndef PROCEDURALPLACEMENT_SPATIAL_INDEX_HPP
+#define PROCEDURALPLACEMENT_SPATIAL_INDEX_HPP
+
+#include "thread_pool.hpp"
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief CPU index of placed entities for radius, box and nearest neighbour queries, e.g. from gameplay code.
+ *
+ * Entities are grouped in tiles that are replaced or erased as a whole, like the slots of the placement output.
+ * Each tile buckets its entities in a uniform grid over its bounding box, sized for a few entities per cell, and
+ * stores them sorted by cell as separate arrays of x, z, height and species. Queries are in the xz plane, in the
+ * texture coordinates of the placement, and are batched: each call answers a span of queries, optionally spread
+ * over a ThreadPool.
+ */
+class SpatialIndex {
+public:
+    /// Entity returned by a query.
+    struct Hit {
+        /// Texture coordinates in x and z, height in y.
+        glm::vec3 position;
+        std::uint32_t species;
+    };
+
+    /// Hits of a batch of queries, those of query i being hits[offsets[i]] up to hits[offsets[i + 1]].
+    struct Results {
+        std::vector<std::size_t> offsets;
+        std::vector<Hit> hits;
+
+        [[nodiscard]] std::span<const Hit> operator[](std::size_t query) const;
+
+        [[nodiscard]] std::size_t queryCount() const;
+    };
+
+    /// Entities of every species.
+    static constexpr std::uint32_t all_species = ~0u;
+
+    /// Entities per grid cell a tile is sized for.
+    static constexpr float entities_per_cell = 8.0f;
+
+    /**
+     * @brief Replace the entities of @p tile.
+     * @param positions Texture coordinates in x and z, height in y.
+     * @param species Species of each position, at most 31.
+     */
+    void setTile(int tile, std::span<const glm::vec3> positions, std::span<const std::uint32_t> species);
+
+    void eraseTile(int tile);
+
+    void clear();
+
+    /// Number of entities of every tile.
+    [[nodiscard]] std::size_t size() const;
+
+    /// Entities within @p radius of each center whose species is in @p species_mask (bit s for species s).
+    void radius(std::span<const glm::vec2> centers, float radius, Results &results,
+                std::uint32_t species_mask = all_species) const;
+
+    /// Entities inside each box [box_min[i], box_max[i]].
+    void box(std::span<const glm::vec2> box_min, std::span<const glm::vec2> box_max, Results &results,
+             std::uint32_t species_mask = all_species) const;
+
+    /// The @p k entities closest to each point, nearest first; fewer if the index holds fewer.
+    void nearest(std::span<const glm::vec2> points, int k, Results &results,
+                 std::uint32_t species_mask = all_species) const;
+
+    /// radius() with the queries split over @p pool.
+    void radius(std::span<const glm::vec2> centers, float radius, Results &results, ThreadPool &pool,
+                std::uint32_t species_mask = all_species) const;
+
+    /// box() with the queries split over @p pool.
+    void box(std::span<const glm::vec2> box_min, std::span<const glm::vec2> box_max, Results &results,
+             ThreadPool &pool, std::uint32_t species_mask = all_species) const;
+
+    /// nearest() with the queries split over @p pool.
+    void nearest(std::span<const glm::vec2> points, int k, Results &results, ThreadPool &pool,
+                 std::uint32_t species_mask = all_species) const;
+
+private:
+    /// Entities of one tile, sorted by grid cell; those of cell c are at indices cell_start[c] to cell_start[c + 1].
+    struct Tile {
+        glm::vec2 bounds_min;
+        glm::vec2 bounds_max;
+        float cell_size;
+        glm::ivec2 cell_count;
+        std::vector<std::uint32_t> cell_start;
+        std::vector<float> x;
+        std::vector<float> z;
+        std::vector<float> height;
+        std::vector<std::uint32_t> species;
+
+        /// Cell containing @p point, clamped to the grid.
+        [[nodiscard]] glm::ivec2 cell(glm::vec2 point) const;
+    };
+
+    /// Answer query i of a batch by appending its hits.
+    using Query = std::function<void(std::size_t, std::vector<Hit> &)>;
+
+    static void runBatch(std::size_t query_count, const Query &query, Results &results);
+
+    static void runBatch(std::size_t query_count, const Query &query, Results &results, ThreadPool &pool);
+
+    void queryBox(glm::vec2 box_min, glm::vec2 box_max, float radius_squared, glm::vec2 center,
+                  std::uint32_t species_mask, std::vector<Hit> &hits) const;
+
+    void queryNearest(glm::vec2 point, int k, std::uint32_t species_mask, std::vector<Hit> &hits) const;
+
+    std::unordered_map<int, Tile> m_tiles;
+    std::size_t m_size {0};
+};
+
+#endif //PROCEDURALPLACEMENT_SPATIAL_INDEX_HPP
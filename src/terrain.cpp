@@ -2,10 +2,52 @@
 
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <glm/geometric.hpp>
 
 #include <imgui.h>
 
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+/// Primitive restart index of 16 bit indices with GL_PRIMITIVE_RESTART_FIXED_INDEX.
+constexpr GLushort restart_index = 0xffff;
+
+/// Two triangles per quad.
+std::vector<GLuint> triangleListIndices(glm::uvec2 size) {
+    std::vector<GLuint> indices;
+    indices.reserve(static_cast<std::size_t>(size.x - 1) * (size.y - 1) * 6);
+    for (GLuint y = 0; y + 1 < size.y; y++) {
+        for (GLuint x = 0; x + 1 < size.x; x++) {
+            const GLuint vertex = y * size.x + x;
+            indices.insert(indices.end(), {vertex, vertex + size.x + 1, vertex + 1,
+                                           vertex + size.x + 1, vertex, vertex + size.x});
+        }
+    }
+    return indices;
+}
+
+/// A strip zigzagging down and right along each row of quads, with the same winding as triangleListIndices() but
+/// the other diagonal.
+std::vector<GLushort> restartStripIndices(glm::uvec2 size) {
+    std::vector<GLushort> indices;
+    indices.reserve(static_cast<std::size_t>(size.y - 1) * (2 * size.x + 1));
+    for (GLuint y = 0; y + 1 < size.y; y++) {
+        if (y > 0)
+            indices.push_back(restart_index);
+        for (GLuint x = 0; x < size.x; x++) {
+            indices.push_back(static_cast<GLushort>(y * size.x + x));
+            indices.push_back(static_cast<GLushort>((y + 1) * size.x + x));
+        }
+    }
+    return indices;
+}
+
+} // namespace
+
 Terrain::Terrain() {
+    loadHeightmapProgram(work_group_tuner.find("heightmap.comp", heightmap_local_size));
     glProgramUniform4fv(blend_program->id(), loc_color0, 1, glm::value_ptr(color0));
     glProgramUniform4fv(blend_program->id(), loc_color1, 1, glm::value_ptr(color1));
 }
@@ -30,12 +72,72 @@ void Terrain::update(GLFWwindow *window, const Camera &camera, double delta) {
 
     ImGui::Text("Terreno");
 
-    if (ImGui::InputInt2("NumWorkGroups", glm::value_ptr(num_work_groups))) {
-        num_work_groups = glm::max(num_work_groups, {1, 1});
+    static constexpr const char *mesh_mode_names[] {"Uniforme", "Quadtree (LOD por bloques)"};
+    if (ImGui::Combo("Modo de malla", reinterpret_cast<int *>(&mesh_mode), mesh_mode_names, 2)) {
+        generateMesh();
+    }
+
+    // without vertex buffer a new grid is only a few uniforms, so it is applied right away
+    bool grid_changed = false;
+    if (mesh_mode == MeshMode::Uniform) {
+        if (ImGui::InputInt2("Bloques de malla", glm::value_ptr(grid_blocks))) {
+            grid_blocks = glm::max(grid_blocks, {1, 1});
+            grid_changed = true;
+        }
+    } else {
+        if (ImGui::InputInt("Niveles LOD", &lod_levels)) {
+            lod_levels = glm::clamp(lod_levels, 1, 7);
+            grid_changed = true;
+        }
+        if (ImGui::InputInt("Celdas por bloque", &chunk_quads)) {
+            chunk_quads = glm::clamp(chunk_quads, 1, 252);
+            grid_changed = true;
+        }
+        grid_changed |= ImGui::DragFloat("Profundidad de faldones", &skirt_depth, 0.001f, 0.0f, 1.0f);
+        ImGui::DragFloat("Distancia LOD", &lod_distance, 0.01f, 0.0f, 100.0f);
+        if (ImGui::InputInt("Presupuesto de triángulos", &triangle_budget, 10000)) {
+            triangle_budget = std::max(triangle_budget, 0);
+        }
+    }
+    if (grid_changed && vertex_format == VertexFormat::Procedural) {
+        generateMesh();
     }
     if (ImGui::Button("Regenerar malla")) {
         generateMesh();
     }
+    // heightmap.comp doesn't run without vertex buffer
+    if (vertex_format != VertexFormat::Procedural && ImGui::Button("Autoajustar grupos de trabajo")) {
+        autotune();
+    }
+    ImGui::Text("Grupo de trabajo: %dx%d", heightmap_local_size.x, heightmap_local_size.y);
+    for (const auto &timing : autotune_results)
+        ImGui::Text("  %dx%d: %.3f ms", timing.local_size.x, timing.local_size.y, timing.milliseconds);
+
+    static constexpr const char *index_layout_names[] {"Lista de triángulos (32 bits)", "Tiras con reinicio (16 bits)"};
+    if (ImGui::Combo("Índices", reinterpret_cast<int *>(&index_layout), index_layout_names, 2)) {
+        applyIndexLayout(index_layout);
+    }
+    if (mesh_index_layout != index_layout) {
+        ImGui::Text("Bloques de más de 65535 vértices: lista de triángulos");
+    }
+
+    static constexpr const char *vertex_format_names[] {"Completo (40 B)", "Compacto (4 B)", "Sin búfer (0 B)"};
+    if (ImGui::Combo("Formato de vértices", reinterpret_cast<int *>(&vertex_format), vertex_format_names, 3)) {
+        generateMesh();
+    }
+    ImGui::Text("Memoria de vértices: %.1f KiB", static_cast<double>(vertex_bytes) / 1024.0);
+
+    selectChunks(camera);
+    ImGui::Text("Bloques dibujados: %d, triángulos: %d", static_cast<int>(selected_chunks.size()),
+                static_cast<int>(selected_chunks.size()) * chunk_triangle_count);
+
+    if (ImGui::Button("Comparar formatos de índices")) {
+        benchmarkIndexLayouts();
+    }
+    for (const auto &result : index_benchmark_results) {
+        ImGui::Text("  %s: %.3f ms, %.1f KiB por bloque", index_layout_names[static_cast<int>(result.layout)],
+                    result.milliseconds, static_cast<double>(result.bytes) / 1024.0);
+    }
 
     ImGui::Checkbox("Mostrar WorldData", &show_world_data);
     if (show_world_data)
@@ -52,87 +154,320 @@ void Terrain::update(GLFWwindow *window, const Camera &camera, double delta) {
 
     ImGui::Checkbox("Mostrar sólo vértices", &show_vertices_only);
     if (show_vertices_only)
-        glDrawArrays(GL_POINTS, 0, vertex_count);
+        glMultiDrawArrays(GL_POINTS, chunk_base_vertices.data(), chunk_vertex_counts.data(),
+                          static_cast<GLsizei>(selected_chunks.size()));
     else
-        glDrawElements(mode, index_count, index_type, reinterpret_cast<const void *>(index_offset));
+        drawChunks();
+}
+
+void Terrain::selectChunks(const Camera &camera) {
+    if (mesh_mode == MeshMode::Uniform) {
+        selected_chunks.assign(1, 0);
+    } else {
+        const int max_chunks = triangle_budget / std::max(chunk_triangle_count, 1);
+        quadtree.select(camera.eye(), parent_transform, lod_distance, std::max(max_chunks, 1), selected_chunks);
+    }
+
+    chunk_index_counts.assign(selected_chunks.size(), chunk_index_count);
+    chunk_vertex_counts.assign(selected_chunks.size(), chunk_vertex_count);
+    chunk_index_offsets.assign(selected_chunks.size(), reinterpret_cast<const void *>(index_offset));
+    chunk_base_vertices.clear();
+    for (const int chunk : selected_chunks)
+        chunk_base_vertices.push_back(chunk * chunk_vertex_count);
+}
+
+void Terrain::drawChunks() const {
+    // the restart index is compared before adding the base vertex, and never occurs in the 32 bit triangle lists
+    glEnable(GL_PRIMITIVE_RESTART_FIXED_INDEX);
+    glMultiDrawElementsBaseVertex(mode, chunk_index_counts.data(), index_type, chunk_index_offsets.data(),
+                                  static_cast<GLsizei>(selected_chunks.size()), chunk_base_vertices.data());
+    glDisable(GL_PRIMITIVE_RESTART_FIXED_INDEX);
+}
+
+void Terrain::benchmarkIndexLayouts() {
+    vertex_array->bind();
+    blend_program->useProgram();
+    GL::ObjectManager<GL::Query> query {GL::Query::Target::TimeElapsed};
+
+    index_benchmark_results.clear();
+    const IndexLayout current = mesh_index_layout;
+    for (const auto layout : {IndexLayout::TriangleList, IndexLayout::RestartStrips16}) {
+        if (layout == IndexLayout::RestartStrips16 && !fitsRestartStrips16(grid_size))
+            continue;
+
+        applyIndexLayout(layout);
+        chunk_index_counts.assign(selected_chunks.size(), chunk_index_count);
+
+        // builds the index buffer if it wasn't cached yet
+        drawChunks();
+
+        query->begin();
+        for (int i = 0; i < index_benchmark_runs; i++)
+            drawChunks();
+        query->end();
+
+        index_benchmark_results.push_back({layout, static_cast<double>(query->result()) * 1e-6 / index_benchmark_runs,
+                                           indexFormat(grid_size, layout).bytes});
+    }
+
+    applyIndexLayout(current);
+    chunk_index_counts.assign(selected_chunks.size(), chunk_index_count);
 }
 
 void Terrain::generateMesh() {
     index_offset = 0;
 
-    glm::ivec3 work_group_size;
-    glGetProgramiv(compute_program->id(), GL_COMPUTE_WORK_GROUP_SIZE, glm::value_ptr(work_group_size));
-    const glm::uvec2 num_compute_threads = num_work_groups * glm::ivec2(work_group_size);
+    // the inputs are clamped one by one, but their product is what the vertex buffer holds
+    if (mesh_mode == MeshMode::Uniform) {
+        constexpr int block_vertex_count = grid_block_size * grid_block_size;
+        grid_blocks.x = std::min(grid_blocks.x, max_vertex_count / block_vertex_count);
+        grid_blocks.y = std::min(grid_blocks.y, max_vertex_count / (block_vertex_count * grid_blocks.x));
+        grid_size = grid_blocks * grid_block_size;
+        chunk_count = 1;
+    } else {
+        quadtree = TerrainQuadtree(lod_levels);
+        chunk_count = quadtree.nodeCount();
+        // 7 levels of chunks of 252 quads would take 355M vertices
+        while (chunk_quads > 1 && (chunk_quads + 3) * (chunk_quads + 3) > max_vertex_count / chunk_count)
+            chunk_quads--;
+        // the chunk_quads + 1 vertices of the surface, and the skirt around them
+        grid_size = glm::uvec2(chunk_quads + 3);
+    }
 
-    vertex_count = num_compute_threads.x * num_compute_threads.y;
-    index_count = (num_compute_threads.x - 1) * (num_compute_threads.y - 1) * 6;
+    chunk_vertex_count = static_cast<GLsizei>(grid_size.x * grid_size.y);
+    vertex_count = chunk_vertex_count * chunk_count;
 
     constexpr GLsizeiptr a_position_alignment = sizeof(glm::vec4);
     constexpr GLsizeiptr a_normal_alignment = sizeof(glm::vec4);
     constexpr GLsizeiptr a_uv_alignment = sizeof(glm::vec2);
-
-    constexpr GLsizeiptr index_alignment = sizeof(unsigned int);
+    constexpr GLsizeiptr a_packed_alignment = sizeof(GLuint);
 
     struct MemoryRange {
         GLintptr offset;
         GLsizeiptr size;
     };
 
-    MemoryRange a_position_mem {0,  a_position_alignment * vertex_count};
-    MemoryRange a_normal_mem {a_position_mem.offset + a_position_mem.size, a_normal_alignment * vertex_count};
-    MemoryRange a_uv_mem {a_normal_mem.offset + a_normal_mem.size, a_uv_alignment * vertex_count};
-    MemoryRange vertex_mem {0, a_position_mem.size + a_normal_mem.size + a_uv_mem.size};
-
-    vertex_buffer->allocate(vertex_mem.size, GL::Buffer::Usage::StaticDraw);
-
-    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 0, vertex_buffer->id(), a_position_mem.offset, a_position_mem.size);
-    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 1, vertex_buffer->id(), a_normal_mem.offset, a_normal_mem.size);
-    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 2, vertex_buffer->id(), a_uv_mem.offset, a_uv_mem.size);
-
-    MemoryRange index_mem {0, index_alignment * index_count};
-    element_buffer->allocate(index_mem.size, GL::Buffer::Usage::StaticDraw);
-
-    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 3, element_buffer->id(), index_mem.offset, index_mem.size);
-
-    compute_program->useProgram();
-    glDispatchCompute(num_work_groups.x, num_work_groups.y, 1);
-
     auto vao = vertex_array.handle();
 
     constexpr int a_pos_loc = 0;
     constexpr int a_normal_loc = 1;
     constexpr int a_uv_loc = 2;
+    constexpr int a_packed_loc = 3;
+
+    if (vertex_format == VertexFormat::Procedural) {
+        // textured.vert builds every vertex from gl_VertexID, the world data and the derivatives
+        vertex_buffer->allocate(0, GL::Buffer::Usage::StaticDraw);
+        vertex_bytes = 0;
+
+        vao.disableAttrib(a_pos_loc);
+        vao.disableAttrib(a_normal_loc);
+        vao.disableAttrib(a_uv_loc);
+        vao.disableAttrib(a_packed_loc);
+    } else if (vertex_format == VertexFormat::Compact) {
+        MemoryRange a_packed_mem {0, a_packed_alignment * vertex_count};
+        vertex_buffer->allocate(a_packed_mem.size, GL::Buffer::Usage::StaticDraw);
+        vertex_bytes = a_packed_mem.size;
+
+        glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 3, vertex_buffer->id(), a_packed_mem.offset, a_packed_mem.size);
+
+        // only the vertices are generated, the topology only depends on the grid size
+        dispatchHeightmap();
+
+        vao.bindVertexBuffer(3, vertex_buffer, a_packed_mem.offset, a_packed_alignment);
+        vao.attribBinding(a_packed_loc, 3);
+        vao.attribIFormat(a_packed_loc, 1, GL_UNSIGNED_INT, 0);
+        vao.enableAttrib(a_packed_loc);
+
+        vao.disableAttrib(a_pos_loc);
+        vao.disableAttrib(a_normal_loc);
+        vao.disableAttrib(a_uv_loc);
+    } else {
+        MemoryRange a_position_mem {0,  a_position_alignment * vertex_count};
+        MemoryRange a_normal_mem {a_position_mem.offset + a_position_mem.size, a_normal_alignment * vertex_count};
+        MemoryRange a_uv_mem {a_normal_mem.offset + a_normal_mem.size, a_uv_alignment * vertex_count};
+        MemoryRange vertex_mem {0, a_position_mem.size + a_normal_mem.size + a_uv_mem.size};
+
+        vertex_buffer->allocate(vertex_mem.size, GL::Buffer::Usage::StaticDraw);
+        vertex_bytes = vertex_mem.size;
+
+        glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 0, vertex_buffer->id(), a_position_mem.offset, a_position_mem.size);
+        glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 1, vertex_buffer->id(), a_normal_mem.offset, a_normal_mem.size);
+        glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 2, vertex_buffer->id(), a_uv_mem.offset, a_uv_mem.size);
+
+        // only the vertices are generated, the topology only depends on the grid size
+        dispatchHeightmap();
+
+        {
+            GL::Buffer buffers[] {vertex_buffer.handle(), vertex_buffer.handle(), vertex_buffer.handle()};
+            GLintptr offsets[] {a_position_mem.offset, a_normal_mem.offset, a_uv_mem.offset};
+            GLsizei strides[] {a_position_alignment, a_normal_alignment, a_uv_alignment};
+
+            vao.bindVertexBuffers(0, 3, buffers, offsets, strides);
+        }
+
+        vao.attribBinding(a_pos_loc, 0);
+        vao.attribFormat(a_pos_loc, 3, GL_FLOAT, false, 0);
+        vao.enableAttrib(a_pos_loc);
+
+        vao.attribBinding(a_normal_loc, 1);
+        vao.attribFormat(a_normal_loc, 3, GL_FLOAT, false, 0);
+        vao.enableAttrib(a_normal_loc);
+
+        vao.attribBinding(a_uv_loc, 2);
+        vao.attribFormat(a_uv_loc, 2, GL_FLOAT, false, 0);
+        vao.enableAttrib(a_uv_loc);
+
+        vao.disableAttrib(a_packed_loc);
+    }
 
-    {
-        GL::Buffer buffers[] {vertex_buffer.handle(), vertex_buffer.handle(), vertex_buffer.handle()};
-        GLintptr offsets[] {a_position_mem.offset, a_normal_mem.offset, a_uv_mem.offset};
-        GLsizei strides[] {a_position_alignment, a_normal_alignment, a_uv_alignment};
+    // textured.vert rebuilds the rest of the compact and procedural vertices from the same grid
+    const float drawn_skirt_depth = mesh_mode == MeshMode::Uniform ? 0.0f : skirt_depth;
+    const GLint compact = vertex_format == VertexFormat::Compact;
+    const GLint procedural = vertex_format == VertexFormat::Procedural;
+    glProgramUniform1i(texture_program->id(), loc_textureCompactVertices, compact);
+    glProgramUniform2ui(texture_program->id(), loc_textureGridSize, grid_size.x, grid_size.y);
+    glProgramUniform1f(texture_program->id(), loc_textureSkirtDepth, drawn_skirt_depth);
+    glProgramUniform1i(texture_program->id(), loc_textureProceduralVertices, procedural);
+    glProgramUniform1i(blend_program->id(), loc_blendCompactVertices, compact);
+    glProgramUniform2ui(blend_program->id(), loc_blendGridSize, grid_size.x, grid_size.y);
+    glProgramUniform1f(blend_program->id(), loc_blendSkirtDepth, drawn_skirt_depth);
+    glProgramUniform1i(blend_program->id(), loc_blendProceduralVertices, procedural);
+
+    applyIndexLayout(index_layout);
+}
 
-        vao.bindVertexBuffers(0, 3, buffers, offsets, strides);
-    }
+Terrain::IndexFormat Terrain::indexFormat(glm::uvec2 size, IndexLayout layout) {
+    const auto quads = static_cast<GLsizei>((size.x - 1) * (size.y - 1));
+    if (layout == IndexLayout::TriangleList)
+        return {GL_TRIANGLES, GL_UNSIGNED_INT, quads * 6, static_cast<GLsizeiptr>(quads * 6 * sizeof(GLuint))};
+
+    // two indices per vertex of each row of quads, and a restart between rows
+    const auto count = static_cast<GLsizei>((size.y - 1) * 2 * size.x + (size.y - 2));
+    return {GL_TRIANGLE_STRIP, GL_UNSIGNED_SHORT, count, static_cast<GLsizeiptr>(count * sizeof(GLushort))};
+}
+
+bool Terrain::fitsRestartStrips16(glm::uvec2 size) {
+    return size.x * size.y <= restart_index;
+}
 
-    vao.attribBinding(a_pos_loc, 0);
-    vao.attribFormat(a_pos_loc, 3, GL_FLOAT, false, 0);
-    vao.enableAttrib(a_pos_loc);
+GL::Buffer Terrain::indexBuffer(glm::uvec2 size, IndexLayout layout) {
+    const auto [it, inserted] = index_buffers.try_emplace({size.x, size.y, layout});
+    if (inserted) {
+        if (layout == IndexLayout::TriangleList)
+            it->second->initialize(triangleListIndices(size), GL::Buffer::Usage::StaticDraw);
+        else
+            it->second->initialize(restartStripIndices(size), GL::Buffer::Usage::StaticDraw);
+    }
+    return it->second.handle();
+}
 
-    vao.attribBinding(a_normal_loc, 1);
-    vao.attribFormat(a_normal_loc, 3, GL_FLOAT, false, 0);
-    vao.enableAttrib(a_normal_loc);
+void Terrain::applyIndexLayout(IndexLayout layout) {
+    if (layout == IndexLayout::RestartStrips16 && !fitsRestartStrips16(grid_size))
+        layout = IndexLayout::TriangleList;
 
-    vao.attribBinding(a_uv_loc, 2);
-    vao.attribFormat(a_uv_loc, 2, GL_FLOAT, false, 0);
-    vao.enableAttrib(a_uv_loc);
+    const IndexFormat format = indexFormat(grid_size, layout);
+    mesh_index_layout = layout;
+    mode = format.mode;
+    index_type = format.type;
+    chunk_index_count = format.count;
+    chunk_triangle_count = static_cast<GLsizei>((grid_size.x - 1) * (grid_size.y - 1) * 2);
 
-    vao.bindElementBuffer(element_buffer);
+    vertex_array->bindElementBuffer(indexBuffer(grid_size, layout));
 }
 
-void Terrain::setParentTransform(const glm::mat4 &matrix) const {
+void Terrain::setParentTransform(const glm::mat4 &matrix) {
+    parent_transform = matrix;
     glProgramUniformMatrix4fv(texture_program->id(), loc_model, 1, false, glm::value_ptr(matrix));
     glProgramUniformMatrix4fv(blend_program->id(), loc_model, 1, false, glm::value_ptr(matrix));
 }
 
-void Terrain::setWorldDataTexUnit(GLint u) const {
+void Terrain::autotune() {
+    // binds the mesh buffers the variants write to
+    generateMesh();
+    autotune_results = work_group_tuner.tune("heightmap.comp",
+                                             [this](glm::ivec2 local_size) { loadHeightmapProgram(local_size); },
+                                             [this] { dispatchHeightmap(); }, 10);
+    loadHeightmapProgram(work_group_tuner.find("heightmap.comp", heightmap_local_size));
+    generateMesh();
+}
+
+void Terrain::loadHeightmapProgram(glm::ivec2 local_size) {
+    heightmap_local_size = local_size;
+    compute_program = GL::ObjectManager<GL::ShaderProgram>(
+            loadComputeProgram("shaders/heightmap.comp", WorkGroupTuner::defines(local_size)));
+    loc_computeWorldData = compute_program->getUniformLocation("u_worldData");
+    loc_gridSize = compute_program->getUniformLocation("u_gridSize");
+    loc_texCoordOffset = compute_program->getUniformLocation("u_texCoordOffset");
+    loc_texCoordScale = compute_program->getUniformLocation("u_texCoordScale");
+    loc_baseVertex = compute_program->getUniformLocation("u_baseVertex");
+    loc_skirtDepth = compute_program->getUniformLocation("u_skirtDepth");
+    loc_compact = compute_program->getUniformLocation("u_compact");
+    glProgramUniform1i(compute_program->id(), loc_computeWorldData, world_data_tex_unit);
+}
+
+void Terrain::dispatchHeightmap() const {
+    const glm::uvec2 local_size = heightmap_local_size;
+    const glm::uvec2 num_work_groups = (grid_size + local_size - 1u) / local_size;
+    const auto id = compute_program->id();
+    glProgramUniform2ui(id, loc_gridSize, grid_size.x, grid_size.y);
+    glProgramUniform1i(id, loc_compact, vertex_format == VertexFormat::Compact);
+    compute_program->useProgram();
+
+    for (int chunk = 0; chunk < chunk_count; chunk++) {
+        // the uniform grid covers the whole map, without skirt
+        const bool uniform = mesh_mode == MeshMode::Uniform;
+        const TerrainQuadtree::Node node = uniform ? TerrainQuadtree::Node {glm::vec2(0.0f), 1.0f, 0}
+                                                   : quadtree.node(chunk);
+        glProgramUniform2fv(id, loc_texCoordOffset, 1, glm::value_ptr(node.origin));
+        glProgramUniform2f(id, loc_texCoordScale, node.size, node.size);
+        glProgramUniform1f(id, loc_skirtDepth, uniform ? 0.0f : skirt_depth);
+        glProgramUniform1ui(id, loc_baseVertex, chunk * chunk_vertex_count);
+        glDispatchCompute(num_work_groups.x, num_work_groups.y, 1);
+    }
+    // the vertices are written as storage buffers and read as vertex attributes by the next draws
+    glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_ELEMENT_ARRAY_BARRIER_BIT);
+}
+
+void Terrain::setWorldDataTexUnit(GLint u) {
+    world_data_tex_unit = u;
     glProgramUniform1i(compute_program->id(), loc_computeWorldData, u);
     glProgramUniform1i(blend_program->id(), loc_blendTexture, u);
     glProgramUniform1i(texture_program->id(), loc_texture, u);
+    glProgramUniform1i(texture_program->id(), loc_textureWorldData, u);
+}
+
+void Terrain::setDerivativesTexUnit(GLint u) {
+    glProgramUniform1i(blend_program->id(), loc_blendDerivatives, u);
+    glProgramUniform1i(texture_program->id(), loc_textureDerivatives, u);
+}
+
+void Terrain::generateDerivatives(glm::ivec2 world_data_size) {
+    if (!derivative_texture || world_data_size != derivative_size) {
+        derivative_size = world_data_size;
+        derivative_texture.emplace(GL::Texture::Target::Tex2D);
+        (*derivative_texture)->storage2D(1, GL::Texture::InternalFormat::RGBA32F, world_data_size.x, world_data_size.y);
+        (*derivative_texture)->setMinFilter(GL::Texture::MinFilter::Linear);
+        (*derivative_texture)->setMaxFilter(GL::Texture::MaxFilter::Linear);
+        (*derivative_texture)->setWrapMode(GL::Texture::WrapAxis::S, GL::Texture::WrapMode::ClampToEdge);
+        (*derivative_texture)->setWrapMode(GL::Texture::WrapAxis::T, GL::Texture::WrapMode::ClampToEdge);
+    }
+
+    // the lengths of the transform's axes, whatever its rotation
+    const glm::vec3 scale {glm::length(glm::vec3(parent_transform[0])), glm::length(glm::vec3(parent_transform[1])),
+                           glm::length(glm::vec3(parent_transform[2]))};
+
+    const auto id = derivative_program->id();
+    glProgramUniform1i(id, loc_derivativeWorldData, world_data_tex_unit);
+    glProgramUniform3fv(id, loc_derivativeScale, 1, glm::value_ptr(scale));
+    glProgramUniform1i(id, loc_derivativeRadius, derivative_radius);
+    glBindImageTexture(derivative_image_unit, (*derivative_texture)->id(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+
+    derivative_program->useProgram();
+    const glm::ivec2 groups = (world_data_size + 7) / 8;
+    glDispatchCompute(groups.x, groups.y, 1);
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+}
+
+GL::Texture Terrain::derivativeTexture() const {
+    return derivative_texture ? derivative_texture->handle() : GL::Texture();
 }
@@ -4,6 +4,7 @@
 #include "gl_utils/gl.hpp"
 #include <GLFW/glfw3.h>
 
+#include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
 #include <glm/mat4x4.hpp>
 
@@ -11,20 +12,120 @@
 #include "utils/shader_load.hpp"
 #include "utils/texture_load.hpp"
 
+#include "terrain_quadtree.hpp"
+#include "work_group_tuner.hpp"
+
+#include <map>
+#include <optional>
+#include <tuple>
+#include <vector>
+
 class Terrain {
 public:
+    /// How generateMesh() lays out the mesh.
+    enum class MeshMode : int {
+        /// A single grid of grid_blocks * grid_block_size vertices along each axis.
+        Uniform,
+        /**
+         * Chunked LOD: a chunk per node of a TerrainQuadtree, all with the same vertices, with skirts hiding the cracks
+         * between chunks of different levels. The chunks are selected every frame from the camera's distance, within a
+         * triangle budget.
+         */
+        Quadtree,
+    };
+
+    /// Vertex layouts of the mesh.
+    enum class VertexFormat : int {
+        /// Position, normal and texture coordinates as floats, 40 bytes.
+        Full,
+        /**
+         * The height as unorm16 and the normal octahedral-encoded as two unorm8, 4 bytes. textured.vert derives the
+         * position and texture coordinates from the vertex's index within its chunk.
+         */
+        Compact,
+        /**
+         * No vertex buffer: textured.vert also fetches the height from the world data and the normal from
+         * derivativeTexture(), so regenerating the mesh, or changing its resolution, only sets uniforms.
+         */
+        Procedural,
+    };
+
+    /// Index layouts of the chunks, see indexBuffer().
+    enum class IndexLayout : int {
+        /// 32 bit triangle list, 6 indices per quad.
+        TriangleList,
+        /**
+         * 16 bit triangle strips, one per row of quads, separated by primitive restarts: about 2 indices per quad, and
+         * consecutive triangles share two vertices. Only for chunks of fewer than 65536 vertices, 0xffff being the
+         * restart index.
+         */
+        RestartStrips16,
+    };
+
     Terrain();
 
     void update(GLFWwindow *window, const Camera& camera, double delta);
     void setCameraPosition(const glm::vec3& pos) const;
     void setViewMatrix(const glm::mat4& matrix) const;
     void setProjMatrix(const glm::mat4& matrix) const;
-    void setParentTransform(const glm::mat4& matrix) const;
-    void setWorldDataTexUnit(GLint u) const;
+    void setParentTransform(const glm::mat4& matrix);
+    void setWorldDataTexUnit(GLint u);
+    /// Unit derivativeTexture() is bound to, which procedural vertices take their normals from.
+    void setDerivativesTexUnit(GLint u);
     void generateMesh();
 
+    /**
+     * @brief Compute derivativeTexture() from the world data texture, of @p world_data_size texels, bound to the world
+     * data unit. The derivatives are in world units, so this has to run again when the parent transform changes.
+     */
+    void generateDerivatives(glm::ivec2 world_data_size);
+
+    /**
+     * @brief RGBA32F texture with the world data's size holding, for each texel, the terrain's dh/dx and dh/dz, its
+     * slope (1 minus the y of the normal) and curvature (the Laplacian of the height), all in world space. Empty before
+     * the first generateDerivatives().
+     */
+    [[nodiscard]] GL::Texture derivativeTexture() const;
+
+    /// Time the work group sizes of heightmap.comp and keep the fastest, which later runs start with.
+    void autotune();
+
+    /// Time drawing the selected chunks with each index layout the chunk size allows, keeping the current one after.
+    void benchmarkIndexLayouts();
+
 private:
 
+    /// Compile heightmap.comp with work groups of @p local_size and query its uniforms again.
+    void loadHeightmapProgram(glm::ivec2 local_size);
+
+    /// Fill the buffers that generateMesh() allocated and bound to the shader storage bindings, one chunk at a time.
+    void dispatchHeightmap() const;
+
+    /// Draw parameters of the indices of a grid.
+    struct IndexFormat {
+        GLenum mode;
+        GLenum type;
+        GLsizei count;
+        GLsizeiptr bytes;
+    };
+
+    [[nodiscard]] static IndexFormat indexFormat(glm::uvec2 size, IndexLayout layout);
+
+    /// Whether the vertices of a grid of @p size can be indexed by the 16 bit strips.
+    [[nodiscard]] static bool fitsRestartStrips16(glm::uvec2 size);
+
+    /// Indices of a grid of @p size vertices, relative to its first vertex, built the first time they are needed.
+    GL::Buffer indexBuffer(glm::uvec2 size, IndexLayout layout);
+
+    /// Draw the chunks with @p layout from now on, for the current grid_size.
+    void applyIndexLayout(IndexLayout layout);
+
+    /// Pick the chunks drawn this frame, the whole grid in uniform mode.
+    void selectChunks(const Camera &camera);
+
+    /// Draw the selected chunks with the current program.
+    void drawChunks() const;
+
     enum UniformLocation {
         loc_model,
         loc_view,
@@ -38,25 +139,107 @@ private:
 
     GL::ObjectManager<GL::ShaderProgram> texture_program {loadProgram("shaders/textured.vert", "shaders/textured.frag")};
     const GLint loc_texture = texture_program->getUniformLocation("u_texture");
+    const GLint loc_textureCompactVertices = texture_program->getUniformLocation("u_compactVertices");
+    const GLint loc_textureGridSize = texture_program->getUniformLocation("u_gridSize");
+    const GLint loc_textureSkirtDepth = texture_program->getUniformLocation("u_skirtDepth");
+    const GLint loc_textureProceduralVertices = texture_program->getUniformLocation("u_proceduralVertices");
+    const GLint loc_textureWorldData = texture_program->getUniformLocation("u_worldData");
+    const GLint loc_textureDerivatives = texture_program->getUniformLocation("u_terrainDerivatives");
 
     GL::ObjectManager<GL::ShaderProgram> blend_program {loadProgram("shaders/textured.vert", "shaders/blend_textured.frag")};
     const GLint loc_blendTexture = blend_program->getUniformLocation("u_worldData");
     const GLint loc_color0 = blend_program->getUniformLocation("u_color0");
     const GLint loc_color1 = blend_program->getUniformLocation("u_color1");
+    const GLint loc_blendCompactVertices = blend_program->getUniformLocation("u_compactVertices");
+    const GLint loc_blendGridSize = blend_program->getUniformLocation("u_gridSize");
+    const GLint loc_blendSkirtDepth = blend_program->getUniformLocation("u_skirtDepth");
+    const GLint loc_blendProceduralVertices = blend_program->getUniformLocation("u_proceduralVertices");
+    const GLint loc_blendDerivatives = blend_program->getUniformLocation("u_terrainDerivatives");
     glm::vec4 color0 {.9, .9, .9, 1.};
     glm::vec4 color1 {.25, .3, .12, 1.};
 
-    GL::ObjectManager<GL::ShaderProgram> compute_program {loadComputeProgram("shaders/heightmap.comp")};
-    const GLint loc_computeWorldData = compute_program->getUniformLocation("u_worldData");
-    glm::ivec2 num_work_groups {8, 8};
+    /// Variant with work groups of heightmap_local_size, see loadHeightmapProgram().
+    GL::ObjectManager<GL::ShaderProgram> compute_program {};
+    GLint loc_computeWorldData {-1};
+    GLint loc_gridSize {-1};
+    GLint loc_texCoordOffset {-1};
+    GLint loc_texCoordScale {-1};
+    GLint loc_baseVertex {-1};
+    GLint loc_skirtDepth {-1};
+    GLint loc_compact {-1};
+    glm::ivec2 heightmap_local_size {8, 8};
+    GLint world_data_tex_unit {0};
+
+    GL::ObjectManager<GL::ShaderProgram> derivative_program {loadComputeProgram("shaders/terrain_derivatives.comp")};
+    const GLint loc_derivativeWorldData = derivative_program->getUniformLocation("u_world_data");
+    const GLint loc_derivativeScale = derivative_program->getUniformLocation("u_scale");
+    const GLint loc_derivativeRadius = derivative_program->getUniformLocation("u_radius");
+    static constexpr GLuint derivative_image_unit = 0;
+    /// Texels between the samples of the finite differences.
+    static constexpr GLint derivative_radius = 4;
+    /// Immutable storage, so it is recreated when the world data size changes.
+    std::optional<GL::ObjectManager<GL::Texture>> derivative_texture;
+    glm::ivec2 derivative_size {0};
+    glm::mat4 parent_transform {1.0f};
+    WorkGroupTuner work_group_tuner;
+    std::vector<WorkGroupTuner::Timing> autotune_results;
+
+    /// Vertices of the mesh along each axis, in blocks of grid_block_size.
+    glm::ivec2 grid_blocks {8, 8};
+    static constexpr int grid_block_size = 8;
+    /// Vertices of the whole mesh at most, which generateMesh() shrinks the grid or the chunks to (640 MiB of full
+    /// vertices).
+    static constexpr GLsizei max_vertex_count = 1 << 24;
+    /// Vertices of each chunk along each axis, the whole mesh in uniform mode.
+    glm::uvec2 grid_size {0};
+
+    MeshMode mesh_mode {MeshMode::Quadtree};
+    /// Levels of the quadtree and quads along each side of a chunk's surface, applied by generateMesh().
+    int lod_levels {5};
+    int chunk_quads {32};
+    /// A chunk is split while the camera is closer to it than lod_distance times its world size.
+    float lod_distance {1.5f};
+    int triangle_budget {300000};
+    /// How far the skirts reach below the chunks' edges, in world data height.
+    float skirt_depth {0.02f};
+
+    TerrainQuadtree quadtree;
+    GLsizei chunk_count {0};
+    /// Vertices and indices of each chunk, skirt included; the chunks share the same indices.
+    GLsizei chunk_vertex_count {0};
+    GLsizei chunk_index_count {0};
+    GLsizei chunk_triangle_count {0};
+
+    VertexFormat vertex_format {VertexFormat::Compact};
+    /// Size of the vertices of every chunk.
+    GLsizeiptr vertex_bytes {0};
+
+    IndexLayout index_layout {IndexLayout::RestartStrips16};
+    /// Layout of the current mesh: chunks too large for 16 bit strips use the triangle list.
+    IndexLayout mesh_index_layout {IndexLayout::TriangleList};
+
+    struct IndexBenchmarkResult {
+        IndexLayout layout;
+        double milliseconds;
+        /// Index memory of a chunk.
+        GLsizeiptr bytes;
+    };
+    static constexpr int index_benchmark_runs = 20;
+    std::vector<IndexBenchmarkResult> index_benchmark_results;
+    /// Chunks drawn this frame, and their ranges for the multi-draw calls.
+    std::vector<int> selected_chunks;
+    std::vector<GLsizei> chunk_index_counts;
+    std::vector<const void *> chunk_index_offsets;
+    std::vector<GLsizei> chunk_vertex_counts;
+    std::vector<GLint> chunk_base_vertices;
 
     GL::ObjectManager<GL::Buffer> vertex_buffer;
-    GL::ObjectManager<GL::Buffer> element_buffer;
+    /// Index buffers of the grid sizes used so far, each shared by every chunk of its size; see indexBuffer().
+    std::map<std::tuple<GLuint, GLuint, IndexLayout>, GL::ObjectManager<GL::Buffer>> index_buffers;
 
     GLenum mode {GL_TRIANGLES};
     GLenum index_type {GL_UNSIGNED_INT};
     GLsizeiptr index_offset {0};
-    GLsizei index_count {0};
     GLsizei vertex_count {0};
     GL::ObjectManager<GL::VertexArray> vertex_array;
 
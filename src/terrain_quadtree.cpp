@@ -0,0 +1,100 @@
+#include "terrain_quadtree.hpp"
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <glm/vec4.hpp>
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+
+TerrainQuadtree::TerrainQuadtree(int levels) : m_levels(levels) {
+    if (levels < 1)
+        throw std::invalid_argument("TerrainQuadtree: at least one level is needed");
+
+    m_nodes.push_back({glm::vec2(0.0f), 1.0f, 0});
+    for (std::size_t parent = 0; m_nodes[parent].level + 1 < levels; parent++) {
+        const Node node = m_nodes[parent];
+        const float child_size = node.size / 2.0f;
+        for (int child = 0; child < 4; child++) {
+            const glm::vec2 offset = glm::vec2(child % 2, child / 2) * child_size;
+            m_nodes.push_back({node.origin + offset, child_size, node.level + 1});
+        }
+    }
+}
+
+int TerrainQuadtree::levels() const {
+    return m_levels;
+}
+
+int TerrainQuadtree::nodeCount() const {
+    return static_cast<int>(m_nodes.size());
+}
+
+const TerrainQuadtree::Node &TerrainQuadtree::node(int index) const {
+    return m_nodes[index];
+}
+
+void TerrainQuadtree::select(glm::vec3 eye, const glm::mat4 &transform, float lod_distance, int max_nodes,
+                             std::vector<int> &selection) const {
+    // camera distance to the node's world bounding box, over the node's world size
+    const auto relative_distance = [&](int index) {
+        const Node &node = m_nodes[index];
+        glm::vec3 box_min {std::numeric_limits<float>::max()};
+        glm::vec3 box_max {std::numeric_limits<float>::lowest()};
+        for (int corner = 0; corner < 8; corner++) {
+            // the heights span the whole world data range, as the chunks' own aren't known on the CPU
+            const glm::vec3 local {node.origin.x + node.size * static_cast<float>(corner & 1),
+                                   static_cast<float>(corner >> 1 & 1),
+                                   node.origin.y + node.size * static_cast<float>(corner >> 2 & 1)};
+            const glm::vec3 world {transform * glm::vec4(local, 1.0f)};
+            box_min = glm::min(box_min, world);
+            box_max = glm::max(box_max, world);
+        }
+
+        const float distance = glm::length(glm::max(glm::max(box_min - eye, eye - box_max), glm::vec3(0.0f)));
+        const float size = std::max(box_max.x - box_min.x, box_max.z - box_min.z);
+        return distance / std::max(size, std::numeric_limits<float>::min());
+    };
+
+    using Candidate = std::pair<float, int>;
+    std::priority_queue<Candidate, std::vector<Candidate>, std::greater<>> candidates;
+    const auto consider = [&](int index) {
+        if (m_nodes[index].level + 1 >= m_levels)
+            return;
+        const float distance = relative_distance(index);
+        if (distance < lod_distance)
+            candidates.emplace(distance, index);
+    };
+
+    std::vector<bool> split(m_nodes.size(), false);
+    int node_count = 1;
+    consider(0);
+
+    // each split replaces a node with its four children
+    while (!candidates.empty() && node_count + 3 <= max_nodes) {
+        const int index = candidates.top().second;
+        candidates.pop();
+
+        split[index] = true;
+        node_count += 3;
+        for (int child = 4 * index + 1; child <= 4 * index + 4; child++)
+            consider(child);
+    }
+
+    selection.clear();
+    std::vector<int> stack {0};
+    while (!stack.empty()) {
+        const int index = stack.back();
+        stack.pop_back();
+        if (!split[index]) {
+            selection.push_back(index);
+            continue;
+        }
+        for (int child = 4 * index + 4; child > 4 * index; child--)
+            stack.push_back(child);
+    }
+}
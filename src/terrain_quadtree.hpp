@@ -0,0 +1,52 @@
+#ifndef PROCEDURALPLACEMENT_TERRAIN_QUADTREE_HPP
+#define PROCEDURALPLACEMENT_TERRAIN_QUADTREE_HPP
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/mat4x4.hpp>
+
+#include <vector>
+
+/**
+ * @brief Quadtree of terrain chunks over the unit square of texture coordinates, for chunked LOD.
+ *
+ * Every node is drawn as a chunk with the same number of vertices, so each level has twice the detail of the one
+ * above it. Nodes are numbered level by level from the root, 0, the children of node n being 4n + 1 to 4n + 4.
+ */
+class TerrainQuadtree {
+public:
+    struct Node {
+        /// Corner of the node, in texture coordinates.
+        glm::vec2 origin;
+        /// Side of the node, in texture coordinates.
+        float size;
+        int level;
+    };
+
+    explicit TerrainQuadtree(int levels = 1);
+
+    [[nodiscard]] int levels() const;
+
+    [[nodiscard]] int nodeCount() const;
+
+    [[nodiscard]] const Node &node(int index) const;
+
+    /**
+     * @brief Nodes to draw for a camera at @p eye, covering the whole square without overlapping.
+     *
+     * Starting from the root, the node nearest to the camera relative to its size is split first, as long as the
+     * camera is within @p lod_distance times the node's world size of its bounding box and the selection stays within
+     * @p max_nodes. Splitting by increasing relative distance spends a budget too small for every wanted split on the
+     * nodes near the camera.
+     * @param transform From texture coordinates, with the height in y, to world space.
+     * @param selection Replaced by the selected nodes.
+     */
+    void select(glm::vec3 eye, const glm::mat4 &transform, float lod_distance, int max_nodes,
+                std::vector<int> &selection) const;
+
+private:
+    std::vector<Node> m_nodes;
+    int m_levels;
+};
+
+#endif //PROCEDURALPLACEMENT_TERRAIN_QUADTREE_HPP
@@ -0,0 +1,112 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <utility>
+
+ThreadPool::ThreadPool(unsigned int thread_count) {
+    if (thread_count == 0)
+        thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+
+    for (unsigned int i = 0; i < thread_count; i++)
+        m_queues.push_back(std::make_unique<Queue>());
+
+    for (unsigned int i = 0; i < thread_count; i++)
+        m_threads.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(m_mutex);
+        m_stop = true;
+    }
+    m_work_available.notify_all();
+
+    for (auto &thread : m_threads)
+        thread.join();
+}
+
+void ThreadPool::run(std::vector<Task> tasks) {
+    if (tasks.empty())
+        return;
+
+    // held until the wait, so the counts are set before any worker can finish one of the tasks
+    std::unique_lock lock(m_mutex);
+    m_pending = tasks.size();
+    m_queued = tasks.size();
+
+    // contiguous runs keep neighbouring tasks on the same worker unless they get stolen
+    const std::size_t queue_count = m_queues.size();
+    for (std::size_t q = 0; q < queue_count; q++) {
+        const std::size_t begin = tasks.size() * q / queue_count;
+        const std::size_t end = tasks.size() * (q + 1) / queue_count;
+
+        std::lock_guard queue_lock(m_queues[q]->mutex);
+        for (std::size_t i = begin; i < end; i++)
+            m_queues[q]->tasks.push_back(std::move(tasks[i]));
+    }
+
+    m_work_available.notify_all();
+
+    m_batch_done.wait(lock, [this] { return m_pending == 0; });
+
+    if (m_error)
+        std::rethrow_exception(std::exchange(m_error, nullptr));
+}
+
+unsigned int ThreadPool::threadCount() const {
+    return static_cast<unsigned int>(m_threads.size());
+}
+
+void ThreadPool::workerLoop(unsigned int index) {
+    while (true) {
+        if (runNextTask(index))
+            continue;
+
+        std::unique_lock lock(m_mutex);
+        m_work_available.wait(lock, [this] { return m_stop || m_queued > 0; });
+        if (m_stop)
+            return;
+    }
+}
+
+bool ThreadPool::runNextTask(unsigned int index) {
+    Task task;
+
+    // own queue first, then the other queues starting from the next one
+    for (std::size_t i = 0; i < m_queues.size() && !task; i++) {
+        const bool own = i == 0;
+        auto &queue = *m_queues[(index + i) % m_queues.size()];
+
+        std::lock_guard lock(queue.mutex);
+        if (queue.tasks.empty())
+            continue;
+
+        if (own) {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        } else {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        }
+    }
+
+    if (!task)
+        return false;
+
+    m_queued--;
+
+    std::exception_ptr error;
+    try {
+        task();
+    } catch (...) {
+        error = std::current_exception();
+    }
+
+    std::lock_guard lock(m_mutex);
+    if (error && !m_error)
+        m_error = error;
+    if (--m_pending == 0)
+        m_batch_done.notify_all();
+
+    return true;
+}
@@ -0,0 +1,71 @@
+#ifndef PROCEDURALPLACEMENT_THREAD_POOL_HPP
+#define PROCEDURALPLACEMENT_THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Fixed set of worker threads running batches of independent tasks.
+ *
+ * Each worker owns a queue, and a batch is split into contiguous runs, one per queue. A worker takes tasks from the
+ * front of its own queue. When that queue is empty, it steals from the back of another worker's queue. Uneven tasks
+ * then balance out without a shared queue that every worker would contend on.
+ */
+class ThreadPool {
+public:
+    using Task = std::function<void()>;
+
+    /// Start @p thread_count workers, or one per hardware thread if it is 0.
+    explicit ThreadPool(unsigned int thread_count = 0);
+
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * @brief Run every task and wait for all of them to finish.
+     *
+     * Only one batch runs at a time. If tasks throw, the first exception is rethrown here after the whole batch has
+     * finished.
+     */
+    void run(std::vector<Task> tasks);
+
+    [[nodiscard]] unsigned int threadCount() const;
+
+private:
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void workerLoop(unsigned int index);
+
+    /// Run a task from the worker's own queue, or one stolen from another queue; false if every queue is empty.
+    bool runNextTask(unsigned int index);
+
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::vector<std::thread> m_threads;
+
+    std::mutex m_mutex;
+    std::condition_variable m_work_available;
+    std::condition_variable m_batch_done;
+    /// Tasks still in a queue.
+    std::atomic<std::size_t> m_queued {0};
+    /// Tasks of the current batch that haven't finished; guarded by m_mutex.
+    std::size_t m_pending {0};
+    std::exception_ptr m_error;
+    bool m_stop {false};
+};
+
+
+#endif //PROCEDURALPLACEMENT_THREAD_POOL_HPP
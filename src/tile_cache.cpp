@@ -0,0 +1,81 @@
+#include "tile_cache.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+
+TileCache::TileCache(int slot_count) : m_slot_count(slot_count) {
+    clear();
+}
+
+int TileCache::find(Tile tile) {
+    auto it = m_entries.find(tile);
+    if (it == m_entries.end())
+        return -1;
+
+    m_lru.splice(m_lru.begin(), m_lru, it->second);
+    return it->second->slot;
+}
+
+TileCache::Insertion TileCache::insert(Tile tile) {
+    if (m_slot_count <= 0)
+        throw std::logic_error("TileCache::insert called on a cache without slots");
+
+    Insertion insertion {0, std::nullopt};
+
+    if (!m_free_slots.empty()) {
+        insertion.slot = m_free_slots.back();
+        m_free_slots.pop_back();
+    } else {
+        auto &victim = m_lru.back();
+        insertion.slot = victim.slot;
+        insertion.evicted = victim.tile;
+
+        m_entries.erase(victim.tile);
+        m_lru.pop_back();
+    }
+
+    m_lru.push_front({tile, insertion.slot});
+    m_entries[tile] = m_lru.begin();
+
+    return insertion;
+}
+
+int TileCache::erase(Tile tile) {
+    auto it = m_entries.find(tile);
+    if (it == m_entries.end())
+        return -1;
+
+    const int slot = it->second->slot;
+    m_lru.erase(it->second);
+    m_entries.erase(it);
+    m_free_slots.push_back(slot);
+    return slot;
+}
+
+void TileCache::clear() {
+    m_lru.clear();
+    m_entries.clear();
+
+    m_free_slots.clear();
+    for (int slot = m_slot_count - 1; slot >= 0; slot--)
+        m_free_slots.push_back(slot);
+}
+
+std::size_t TileCache::size() const {
+    return m_lru.size();
+}
+
+const std::list<TileCache::Entry> &TileCache::entries() const {
+    return m_lru;
+}
+
+int TileCache::slotCount() const {
+    return m_slot_count;
+}
+
+std::size_t TileCache::TileHash::operator()(Tile tile) const {
+    const auto key = static_cast<std::uint64_t>(static_cast<std::uint32_t>(tile.x)) << 32
+                     | static_cast<std::uint32_t>(tile.y);
+    return std::hash<std::uint64_t>()(key);
+}
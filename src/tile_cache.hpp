@@ -0,0 +1,65 @@
+#ifndef PROCEDURALPLACEMENT_TILE_CACHE_HPP
+#define PROCEDURALPLACEMENT_TILE_CACHE_HPP
+
+#include <glm/vec2.hpp>
+
+#include <cstddef>
+#include <list>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+/// Assigns a fixed number of slots to tiles, keyed by their integer tile coordinates, evicting the least recently
+/// used tile when every slot is taken. Slots freed by erase() are reused before evicting anything.
+class TileCache {
+public:
+    using Tile = glm::ivec2;
+
+    struct Entry {
+        Tile tile;
+        int slot;
+    };
+
+    struct Insertion {
+        int slot;
+        /// Tile that previously held the slot, if any.
+        std::optional<Tile> evicted;
+    };
+
+    explicit TileCache(int slot_count = 0);
+
+    /// Slot holding @p tile (marking it as the most recently used), or -1 if the tile isn't cached.
+    int find(Tile tile);
+
+    /// Assign a slot to @p tile, which must not be cached already.
+    Insertion insert(Tile tile);
+
+    /// Drop @p tile, freeing its slot. Returns the slot, or -1 if the tile wasn't cached.
+    int erase(Tile tile);
+
+    /// Drop every tile; all slots become free.
+    void clear();
+
+    [[nodiscard]] std::size_t size() const;
+
+    /// Cached tiles, most recently used first.
+    [[nodiscard]] const std::list<Entry>& entries() const;
+
+    [[nodiscard]] int slotCount() const;
+
+private:
+
+    struct TileHash {
+        std::size_t operator()(Tile tile) const;
+    };
+
+    int m_slot_count;
+    /// Slots not assigned to any tile; insert() takes the last one.
+    std::vector<int> m_free_slots;
+    /// Most recently used first.
+    std::list<Entry> m_lru;
+    std::unordered_map<Tile, std::list<Entry>::iterator, TileHash> m_entries;
+};
+
+
+#endif //PROCEDURALPLACEMENT_TILE_CACHE_HPP
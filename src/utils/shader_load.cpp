@@ -3,14 +3,25 @@
 #include <fstream>
 #include <sstream>
 
-GL::Shader loadShader(const std::string &path, GL::ShaderType shader_type) {
+GL::Shader loadShader(const std::string &path, GL::ShaderType shader_type, const ShaderDefines &defines) {
     std::fstream file {path};
     std::stringstream sstream;
     sstream << file.rdbuf();
+    std::string source = sstream.str();
+
+    // #version has to come first; #line keeps the compiler's line numbers matching the file
+    if (!defines.empty()) {
+        const auto version_end = source.find('\n', source.find("#version"));
+        std::string injected = "\n";
+        for (const auto &[name, value] : defines)
+            injected += "#define " + name + " " + value + "\n";
+        injected += "#line 2\n";
+        source.replace(version_end, 1, injected);
+    }
 
     auto shader = GL::Shader::create(shader_type);
     glObjectLabel(GL_SHADER, shader.id(), -1, path.c_str());
-    shader.setSource( sstream.str() );
+    shader.setSource(source);
     shader.compileShader();
 
     return shader;
@@ -32,9 +43,9 @@ GL::ShaderProgram loadProgram(const std::string & vs_path, const std::string & f
     return program;
 }
 
-GL::ShaderProgram loadComputeProgram(const std::string &cs_path) {
+GL::ShaderProgram loadComputeProgram(const std::string &cs_path, const ShaderDefines &defines) {
     auto program = GL::ShaderProgram::create();
-    GL::ObjectManager comp {loadShader(cs_path, GL::ShaderType::Compute)};
+    GL::ObjectManager comp {loadShader(cs_path, GL::ShaderType::Compute, defines)};
 
     program.attachShader(comp.handle());
 
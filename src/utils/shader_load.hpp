@@ -4,8 +4,15 @@
 #include <glad/glad.h>
 #include "../gl_utils/gl.hpp"
 
-GL::Shader loadShader(const std::string &path, GL::ShaderType shader_type);
+#include <string>
+#include <utility>
+#include <vector>
+
+/// Preprocessor definitions (name, value) injected right after a shader's #version line.
+using ShaderDefines = std::vector<std::pair<std::string, std::string>>;
+
+GL::Shader loadShader(const std::string &path, GL::ShaderType shader_type, const ShaderDefines &defines = {});
 GL::ShaderProgram loadProgram(const std::string & vs_path, const std::string & fs_path);
-GL::ShaderProgram loadComputeProgram(const std::string &cs_path);
+GL::ShaderProgram loadComputeProgram(const std::string &cs_path, const ShaderDefines &defines = {});
 
 #endif //PROCEDURALPLACEMENT_SHADER_LOAD_HPP
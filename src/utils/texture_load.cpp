@@ -1,10 +1,10 @@
 #include "texture_load.hpp"
 
-#include "image.hpp"
-
 GL::Texture loadTexture(const char* file_path) {
-    Image image(file_path);
+    return loadTexture(Image(file_path));
+}
 
+GL::Texture loadTexture(const Image& image) {
     using IFormat = GL::Texture::InternalFormat;
     using Format = GL::Texture::Format;
     using Type = GL::Texture::Type;
@@ -3,6 +3,11 @@
 
 #include "../gl_utils/gl.hpp"
 
+#include "image.hpp"
+
 GL::Texture loadTexture(const char* file_path);
 
+/// Upload an image that is already loaded, e.g. because the CPU also reads it.
+GL::Texture loadTexture(const Image& image);
+
 #endif //PROCEDURALPLACEMENT_TEXTURE_LOAD_HPP
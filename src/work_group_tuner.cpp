@@ -0,0 +1,79 @@
+#include "work_group_tuner.hpp"
+
+#include <glm/vector_relational.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <utility>
+
+WorkGroupTuner::WorkGroupTuner(std::string cache_path) : m_cache_path(std::move(cache_path)) {
+    const auto renderer = reinterpret_cast<const char *>(glGetString(GL_RENDERER));
+    m_renderer = renderer ? renderer : "";
+    // the separator can't be part of a key
+    std::replace(m_renderer.begin(), m_renderer.end(), ';', ',');
+    load();
+}
+
+glm::ivec2 WorkGroupTuner::find(const std::string &kernel, glm::ivec2 fallback) const {
+    const auto it = m_sizes.find(key(kernel));
+    return it != m_sizes.end() ? it->second : fallback;
+}
+
+std::vector<WorkGroupTuner::Timing> WorkGroupTuner::tune(const std::string &kernel,
+                                                         const std::function<void(glm::ivec2)> &use,
+                                                         const std::function<void()> &run, int runs) {
+    GL::ObjectManager<GL::Query> query {GL::Query::Target::TimeElapsed};
+    std::vector<Timing> timings;
+    for (const auto local_size : candidates) {
+        use(local_size);
+
+        // warms up the variant, whose first dispatch may finish compiling it
+        run();
+
+        query->begin();
+        for (int i = 0; i < runs; i++)
+            run();
+        query->end();
+
+        timings.push_back({local_size, static_cast<double>(query->result()) * 1e-6 / runs});
+    }
+
+    const auto fastest = std::min_element(timings.begin(), timings.end(), [](const Timing &a, const Timing &b) {
+        return a.milliseconds < b.milliseconds;
+    });
+    load();
+    m_sizes[key(kernel)] = fastest->local_size;
+    save();
+
+    return timings;
+}
+
+ShaderDefines WorkGroupTuner::defines(glm::ivec2 local_size) {
+    return {{"LOCAL_SIZE_X", std::to_string(local_size.x)}, {"LOCAL_SIZE_Y", std::to_string(local_size.y)}};
+}
+
+void WorkGroupTuner::load() {
+    std::ifstream file {m_cache_path};
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream fields {line};
+        std::string renderer, kernel;
+        glm::ivec2 size;
+        char separator;
+        if (std::getline(fields, renderer, ';') && std::getline(fields, kernel, ';') &&
+            fields >> size.x >> separator >> size.y && separator == ';' &&
+            glm::all(glm::greaterThan(size, glm::ivec2(0))))
+            m_sizes[renderer + ';' + kernel] = size;
+    }
+}
+
+void WorkGroupTuner::save() const {
+    std::ofstream file {m_cache_path, std::ios::trunc};
+    for (const auto &[key, size] : m_sizes)
+        file << key << ';' << size.x << ';' << size.y << '\n';
+}
+
+std::string WorkGroupTuner::key(const std::string &kernel) const {
+    return m_renderer + ';' + kernel;
+}
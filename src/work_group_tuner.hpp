@@ -0,0 +1,62 @@
+#ifndef PROCEDURALPLACEMENT_WORK_GROUP_TUNER_HPP
+#define PROCEDURALPLACEMENT_WORK_GROUP_TUNER_HPP
+
+#include "gl_utils/gl.hpp"
+
+#include "utils/shader_load.hpp"
+
+#include <glm/vec2.hpp>
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Picks the work group size of 2D compute kernels by timing their variants on the current GPU.
+ *
+ * The kernels declare their size as LOCAL_SIZE_X and LOCAL_SIZE_Y, set through loadComputeProgram()'s defines. The
+ * fastest size of each kernel is kept in a text file, one "renderer;kernel;x;y" line each, so that later runs on the
+ * same GPU start with it. Entries of other renderers are kept but never used.
+ */
+class WorkGroupTuner {
+public:
+    /// Work group sizes tried by tune(), all within the 1024 invocations every implementation supports.
+    static constexpr glm::ivec2 candidates[] {{4, 4}, {8, 4}, {8, 8}, {16, 8}, {16, 16}, {32, 8}, {32, 32}};
+
+    struct Timing {
+        glm::ivec2 local_size;
+        double milliseconds;
+    };
+
+    explicit WorkGroupTuner(std::string cache_path = "work_group_sizes.txt");
+
+    /// Size cached for @p kernel on the current renderer, or @p fallback if it was never tuned.
+    [[nodiscard]] glm::ivec2 find(const std::string &kernel, glm::ivec2 fallback) const;
+
+    /**
+     * @brief Time every candidate size of @p kernel and cache the fastest.
+     * @param use Switch the kernel to a size, e.g. by compiling that variant; not timed.
+     * @param run Work timed @p runs times per size, after a first untimed run.
+     * @return Average time of a run with each size, in candidates order.
+     */
+    std::vector<Timing> tune(const std::string &kernel, const std::function<void(glm::ivec2)> &use,
+                             const std::function<void()> &run, int runs);
+
+    /// LOCAL_SIZE_X and LOCAL_SIZE_Y set to @p local_size.
+    [[nodiscard]] static ShaderDefines defines(glm::ivec2 local_size);
+
+private:
+    /// Read the entries of the cache file, which may have been written by another tuner since.
+    void load();
+
+    void save() const;
+
+    [[nodiscard]] std::string key(const std::string &kernel) const;
+
+    std::string m_cache_path;
+    std::string m_renderer;
+    std::map<std::string, glm::ivec2> m_sizes;
+};
+
+#endif //PROCEDURALPLACEMENT_WORK_GROUP_TUNER_HPP